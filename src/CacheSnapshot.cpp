@@ -0,0 +1,226 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#include "CacheSnapshot.h"
+#include "FileSystemModel.h"
+#include "Platform.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDirIterator>
+#include <QDataStream>
+#include <QSet>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QDebug>
+
+namespace {
+constexpr quint32 snapshotMagic = 0x5941594e; // "YAYN"
+constexpr quint32 snapshotVersion = 3;
+constexpr qint64 unsettledMsecs = 2000; // mtimes this recent may still change within the same tick
+
+qint64 modificationTime(const QString &path) {
+    return QFileInfo(path).lastModified().toMSecsSinceEpoch();
+}
+
+QString categoryOf(const QDir &root, const QString &parentPath) {
+    QString rel = root.relativeFilePath(parentPath);
+    if (rel == QLatin1String("."))
+        rel.clear();
+    return rel;
+}
+} // namespace
+
+CacheSnapshot::CacheSnapshot(const QDir &root) : m_root(root) {}
+
+QString CacheSnapshot::filePath() const {
+    const QByteArray rootHash = QCryptographicHash::hash(m_root.absolutePath().toUtf8(),
+                                                         QCryptographicHash::Sha1).toHex();
+    QDir d(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    d.mkpath(QStringLiteral("snapshots"));
+    return d.absoluteFilePath(QStringLiteral("snapshots/") + QString::fromLatin1(rootHash) + ".bin");
+}
+
+// Relative path of every category (root included, as "") -> mtime in msecs
+QHash<QString, qint64> CacheSnapshot::directoryTimes() const {
+    QHash<QString, qint64> res;
+    res.insert(QString(), modificationTime(m_root.absolutePath()));
+    QDirIterator it(m_root.absolutePath(), QDir::Dirs | QDir::NoDotAndDotDot,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo fi = it.fileInfo();
+        res.insert(m_root.relativeFilePath(fi.absoluteFilePath()),
+                   fi.lastModified().toMSecsSinceEpoch());
+    }
+    return res;
+}
+
+bool CacheSnapshot::load(QHash<QString, VideoMetadata> &videos,
+                         QHash<QString, ChannelMetadata> &channels,
+                         bool withChannels) {
+    QFile f(filePath());
+    if (!f.exists())
+        return false;
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed opening file " << f.fileName() << " for reading.";
+        return false;
+    }
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0, version = 0;
+    QString rootPath;
+    in >> magic >> version >> rootPath;
+    if (magic != snapshotMagic || version != snapshotVersion
+        || rootPath != m_root.absolutePath()) {
+        f.close();
+        f.remove();
+        return false;
+    }
+
+    QHash<QString, qint64> snapshotTimes;
+    qint64 snapshotChannelsTime = -1;
+    in >> snapshotTimes >> snapshotChannelsTime;
+
+    const QHash<QString, qint64> currentTimes = directoryTimes();
+    QSet<QString> unchanged;
+    for (auto i = currentTimes.cbegin(); i != currentTimes.cend(); ++i) {
+        if (snapshotTimes.value(i.key(), -1) == i.value())
+            unchanged.insert(i.key());
+    }
+
+    QHash<QString, VideoMetadata> res;
+    QHash<QString, CategoryTable::Id> categories;
+    qint64 count = 0;
+    in >> count;
+    for (qint64 n = 0; n < count && in.status() == QDataStream::Ok; ++n) {
+        QString key, category;
+        in >> key >> category;
+        auto c = categories.constFind(category);
+        if (c == categories.constEnd()) {
+            c = categories.insert(category,
+                                  CategoryTable::intern(category.isEmpty() ? m_root.absolutePath()
+                                                                           : m_root.filePath(category)));
+        }
+        VideoMetadata v(key, c.value());
+        in >> v.title >> v.channelID >> v.duration >> v.position
+           >> v.viewed >> v.starred >> v.thumbnailData >> v.thumbnailRef >> v.creationDate >> v.accessDate;
+        if (unchanged.contains(category))
+            res.insert(key, v);
+    }
+
+    QHash<QString, ChannelMetadata> resChannels;
+    in >> count;
+    QDir channelsDir(m_root);
+    channelsDir.cd(".channels");
+    for (qint64 n = 0; n < count && in.status() == QDataStream::Ok; ++n) {
+        QString key;
+        int vendor = 0;
+        in >> key;
+        ChannelMetadata c(key, channelsDir);
+        in >> c.name >> c.id >> vendor >> c.thumbnailData >> c.creationDate;
+        c.vendor = Platform::Vendor(vendor);
+        resChannels.insert(key, c);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        qWarning() << "Discarding corrupt cache snapshot " << f.fileName();
+        f.close();
+        f.remove();
+        return false;
+    }
+    f.close();
+    f.remove();
+
+    // Re-read whatever changed on disk since the snapshot was taken
+    QList<QDir> changed;
+    for (auto i = currentTimes.cbegin(); i != currentTimes.cend(); ++i) {
+        if (!unchanged.contains(i.key()))
+            changed.append(i.key().isEmpty() ? m_root : QDir(m_root.filePath(i.key())));
+    }
+    if (!changed.isEmpty())
+        res.insert(cacheDirectories(changed));
+    videos = res;
+
+    if (withChannels) {
+        if (snapshotChannelsTime >= 0
+            && snapshotChannelsTime == modificationTime(channelsDir.absolutePath())) {
+            channels = resChannels;
+        } else {
+            channels = cacheChannels(m_root);
+        }
+    }
+    return true;
+}
+
+bool CacheSnapshot::save(const QHash<QString, VideoMetadata> &videos,
+                         const QHash<QString, ChannelMetadata> &channels,
+                         bool withChannels) const {
+    QSaveFile f(filePath());
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed opening file " << f.fileName() << " for writing.";
+        return false;
+    }
+    QDataStream out(&f);
+    out.setVersion(QDataStream::Qt_6_0);
+
+    const qint64 settled = QDateTime::currentMSecsSinceEpoch() - unsettledMsecs;
+    QHash<QString, qint64> times = directoryTimes();
+    for (auto &t : times) {
+        if (t > settled)
+            t = -1; // force a re-read of this directory next time
+    }
+    qint64 channelsTime = -1;
+    if (withChannels) {
+        QDir channelsDir(m_root);
+        if (channelsDir.cd(".channels")) {
+            channelsTime = modificationTime(channelsDir.absolutePath());
+            if (channelsTime > settled)
+                channelsTime = -1;
+        }
+    }
+
+    out << snapshotMagic << snapshotVersion << m_root.absolutePath();
+    out << times << channelsTime;
+
+    out << qint64(videos.size());
+    QHash<CategoryTable::Id, QString> categories;
+    for (const auto &v : videos) {
+        auto c = categories.constFind(v.category);
+        if (c == categories.constEnd())
+            c = categories.insert(v.category, categoryOf(m_root, v.parentPath()));
+        out << v.key << c.value()
+            << v.title << v.channelID << v.duration << v.position
+            << v.viewed << v.starred << v.thumbnailData << v.thumbnailRef << v.creationDate << v.accessDate;
+    }
+
+    out << qint64(withChannels ? channels.size() : 0);
+    if (withChannels) {
+        for (const auto &c : channels) {
+            out << c.key() << c.name << c.id << int(c.vendor)
+                << c.thumbnailData << c.creationDate;
+        }
+    }
+
+    if (!f.commit()) {
+        qWarning() << "Failed writing cache snapshot " << f.fileName() << " : " << f.errorString();
+        return false;
+    }
+    return true;
+}
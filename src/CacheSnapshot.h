@@ -0,0 +1,53 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#ifndef CACHESNAPSHOT_H
+#define CACHESNAPSHOT_H
+
+#include "VideoMetadata.h"
+#include "ChannelMetadata.h"
+
+#include <QDir>
+#include <QHash>
+#include <QString>
+
+// Binary dump of what cacheRoot()/cacheChannels() produce for a root, kept in the cache
+// location and written when the model goes away. On load, every category directory's
+// mtime is compared with the one recorded in the snapshot, and only directories that
+// changed since (or that are new) are read from disk again.
+// A snapshot is consumed by load(): if the app dies before writing the next one, the
+// following start is a cold one instead of trusting stale positions.
+class CacheSnapshot
+{
+public:
+    explicit CacheSnapshot(const QDir &root);
+
+    QString filePath() const;
+    bool load(QHash<QString, VideoMetadata> &videos,
+              QHash<QString, ChannelMetadata> &channels,
+              bool withChannels);
+    bool save(const QHash<QString, VideoMetadata> &videos,
+              const QHash<QString, ChannelMetadata> &channels,
+              bool withChannels) const;
+
+private:
+    QHash<QString, qint64> directoryTimes() const;
+
+    QDir m_root;
+};
+
+#endif // CACHESNAPSHOT_H
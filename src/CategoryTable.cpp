@@ -0,0 +1,112 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#include "CategoryTable.h"
+
+#include <QDir>
+#include <QHash>
+#include <QReadWriteLock>
+
+namespace {
+struct Table {
+    QReadWriteLock lock;
+    QList<QString> prefixes{QString()}; // absolute path + '/'; row 0 is the empty path
+    QHash<QString, CategoryTable::Id> index{{QString(), 0}};
+};
+
+Table &table() {
+    static Table t;
+    return t;
+}
+
+QString prefixOf(const QString &dirPath) {
+    if (dirPath.isEmpty())
+        return {};
+    QString p = QDir::cleanPath(QDir(dirPath).absolutePath());
+    if (!p.endsWith(QLatin1Char('/')))
+        p.append(QLatin1Char('/'));
+    return p;
+}
+} // namespace
+
+CategoryTable::Id CategoryTable::intern(const QString &dirPath) {
+    const QString prefix = prefixOf(dirPath);
+    Table &t = table();
+    {
+        QReadLocker locker(&t.lock);
+        auto it = t.index.constFind(prefix);
+        if (it != t.index.constEnd())
+            return it.value();
+    }
+    QWriteLocker locker(&t.lock);
+    auto it = t.index.constFind(prefix);
+    if (it != t.index.constEnd())
+        return it.value();
+    const Id id = Id(t.prefixes.size());
+    t.prefixes.append(prefix);
+    t.index.insert(prefix, id);
+    return id;
+}
+
+CategoryTable::Id CategoryTable::find(const QString &dirPath) {
+    const QString prefix = prefixOf(dirPath);
+    Table &t = table();
+    QReadLocker locker(&t.lock);
+    return t.index.value(prefix, 0);
+}
+
+QString CategoryTable::path(Id id) {
+    Table &t = table();
+    QReadLocker locker(&t.lock);
+    const QString &prefix = t.prefixes.at(id);
+    return prefix.size() > 1 ? prefix.chopped(1) : prefix; // keep "/" for the file system root
+}
+
+QString CategoryTable::filePath(Id id, QStringView baseName, QStringView suffix) {
+    Table &t = table();
+    QReadLocker locker(&t.lock);
+    const QString &prefix = t.prefixes.at(id);
+    QString res;
+    res.reserve(prefix.size() + baseName.size() + 1 + suffix.size());
+    res.append(prefix);
+    res.append(baseName);
+    res.append(QLatin1Char('.'));
+    res.append(suffix);
+    return res;
+}
+
+QList<CategoryTable::Id> CategoryTable::rename(const QString &oldPath, const QString &newPath) {
+    const QString oldPrefix = prefixOf(oldPath);
+    const QString newPrefix = prefixOf(newPath);
+    QList<Id> moved;
+    if (oldPrefix.isEmpty() || newPrefix.isEmpty() || oldPrefix == newPrefix)
+        return moved;
+
+    Table &t = table();
+    QWriteLocker locker(&t.lock);
+    for (Id id = 1; id < Id(t.prefixes.size()); ++id) {
+        QString &prefix = t.prefixes[id];
+        if (!prefix.startsWith(oldPrefix))
+            continue;
+        if (t.index.value(prefix) == id)
+            t.index.remove(prefix);
+        prefix = newPrefix + prefix.mid(oldPrefix.size());
+        t.index.insert(prefix, id);
+        moved.append(id);
+    }
+    return moved;
+}
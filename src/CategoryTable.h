@@ -0,0 +1,42 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#ifndef CATEGORYTABLE_H
+#define CATEGORYTABLE_H
+
+#include <QString>
+#include <QStringView>
+#include <QList>
+
+// Process-wide table of the directories holding video records.
+// Records keep a small id instead of a QDir each. The absolute path of every row is
+// built once, with a trailing '/', so file paths are a single concatenation.
+// Renaming a directory rewrites its row and the rows below it, and every record in
+// them follows. All functions are safe to call from worker threads.
+class CategoryTable
+{
+public:
+    using Id = quint32;
+
+    static Id intern(const QString &dirPath);
+    static Id find(const QString &dirPath); // without interning, 0 if not there
+    static QString path(Id id);                        // absolute, without trailing '/'
+    static QString filePath(Id id, QStringView baseName, QStringView suffix); // <path>/<base>.<suffix>
+    static QList<Id> rename(const QString &oldPath, const QString &newPath); // ids that moved
+};
+
+#endif // CATEGORYTABLE_H
@@ -0,0 +1,185 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+#include "CategoryTree.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <numeric>
+
+int CategoryTree::Node::videoSlot(const QString &key) const {
+    if (!keySlotsValid) {
+        keySlots.clear();
+        keySlots.reserve(videos.size());
+        for (int i = 0; i < videos.size(); ++i)
+            keySlots.insert(videos.at(i), i);
+        keySlotsValid = true;
+    }
+    return keySlots.value(key, -1);
+}
+
+int CategoryTree::Node::videoRow(const QString &key) const {
+    const int i = videoSlot(key);
+    return i < 0 ? -1 : int(dirs.size() + i);
+}
+
+void CategoryTree::reset(const QString &rootPath) {
+    qDeleteAll(m_top.dirs);
+    m_top.dirs.clear();
+    m_nodes.clear();
+    m_placed.clear();
+    if (rootPath.isEmpty())
+        return;
+    Node *n = new Node;
+    n->parent = &m_top;
+    n->id = CategoryTable::intern(rootPath);
+    n->name = QDir(rootPath).dirName();
+    m_top.dirs.append(n);
+    m_nodes.insert(n->id, n);
+}
+
+void CategoryTree::scan() {
+    Node *r = root();
+    if (!r)
+        return;
+    QDirIterator it(CategoryTable::path(r->id), QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext())
+        ensure(it.next());
+}
+
+CategoryTree::Node *CategoryTree::node(const QString &path) const {
+    const CategoryTable::Id id = CategoryTable::find(path);
+    return id ? node(id) : nullptr;
+}
+
+CategoryTree::Node *CategoryTree::ensure(const QString &path) {
+    if (Node *n = node(path))
+        return n;
+    Node *r = root();
+    if (!r || !path.startsWith(CategoryTable::path(r->id) + QLatin1Char('/')))
+        return nullptr;
+    Node *parent = ensure(QFileInfo(path).absolutePath());
+    return parent ? addCategory(parent, path) : nullptr;
+}
+
+CategoryTree::Node *CategoryTree::addCategory(Node *parent, const QString &path) {
+    Node *n = new Node;
+    n->parent = parent;
+    n->id = CategoryTable::intern(path);
+    n->name = QFileInfo(path).fileName();
+    parent->dirs.insert(dirSlot(parent, n->name), n);
+    m_nodes.insert(n->id, n);
+    return n;
+}
+
+void CategoryTree::removeCategory(Node *n) {
+    if (!n->parent)
+        return;
+    n->parent->dirs.removeOne(n);
+    forget(n);
+    delete n;
+}
+
+// The subtree keeps its nodes, a rename in the CategoryTable already moved their paths
+void CategoryTree::moveCategory(Node *n, Node *newParent) {
+    n->parent->dirs.removeOne(n);
+    n->parent = newParent;
+    n->name = QFileInfo(CategoryTable::path(n->id)).fileName();
+    newParent->dirs.insert(dirSlot(newParent, n->name), n);
+}
+
+void CategoryTree::insertVideo(Node *n, int slot, const QString &key, int tableRow, qint64 sortKey) {
+    if (slot == n->videos.size()) // nothing shifts
+        n->keySlots.insert(key, slot);
+    else
+        n->keySlotsValid = false;
+    n->videos.insert(slot, key);
+    n->tableRows.insert(slot, tableRow);
+    n->sortKeys.insert(slot, sortKey);
+    m_placed.insert(key, n);
+}
+
+void CategoryTree::appendVideo(Node *n, const QString &key, int tableRow, qint64 sortKey) {
+    insertVideo(n, int(n->videos.size()), key, tableRow, sortKey);
+}
+
+// Stable, and on the keys alone, so that nothing is read from the cache while sorting
+QList<int> CategoryTree::sortVideos(Node *n) {
+    QList<int> order(n->videos.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [n](int a, int b) {
+        return n->sortKeys.at(a) < n->sortKeys.at(b);
+    });
+    QStringList videos;
+    QList<int> tableRows;
+    QList<qint64> sortKeys;
+    videos.reserve(order.size());
+    tableRows.reserve(order.size());
+    sortKeys.reserve(order.size());
+    for (int i : std::as_const(order)) {
+        videos.append(n->videos.at(i));
+        tableRows.append(n->tableRows.at(i));
+        sortKeys.append(n->sortKeys.at(i));
+    }
+    n->videos.swap(videos);
+    n->tableRows.swap(tableRows);
+    n->sortKeys.swap(sortKeys);
+    n->keySlotsValid = false;
+    return order;
+}
+
+void CategoryTree::removeVideo(const QString &key) {
+    Node *n = m_placed.value(key);
+    if (n)
+        removeVideos(n, n->videoSlot(key), 1);
+}
+
+void CategoryTree::removeVideos(Node *n, int slot, int count) {
+    if (slot < 0 || count <= 0)
+        return;
+    for (int i = slot; i < slot + count; ++i) {
+        m_placed.remove(n->videos.at(i));
+        n->keySlots.remove(n->videos.at(i));
+    }
+    if (slot + count < n->videos.size()) // the ones after shift
+        n->keySlotsValid = false;
+    n->videos.remove(slot, count);
+    n->tableRows.remove(slot, count);
+    n->sortKeys.remove(slot, count);
+}
+
+int CategoryTree::dirSlot(const Node *parent, const QString &name) {
+    const auto it = std::lower_bound(parent->dirs.cbegin(), parent->dirs.cend(), name,
+                                     [](const Node *d, const QString &n) { return d->name < n; });
+    return int(it - parent->dirs.cbegin());
+}
+
+// After the videos with the same key, so that ties keep their insertion order
+int CategoryTree::videoSlot(const Node *n, qint64 sortKey) {
+    const auto it = std::upper_bound(n->sortKeys.cbegin(), n->sortKeys.cend(), sortKey);
+    return int(it - n->sortKeys.cbegin());
+}
+
+void CategoryTree::forget(Node *n) {
+    m_nodes.remove(n->id);
+    for (const auto &key : std::as_const(n->videos))
+        m_placed.remove(key);
+    for (Node *d : std::as_const(n->dirs))
+        forget(d);
+}
@@ -0,0 +1,93 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+#ifndef CATEGORYTREE_H
+#define CATEGORYTREE_H
+
+#include "CategoryTable.h"
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// Shape of a root as FileSystemModel presents it: one node per category directory, holding
+// its subcategories and the keys of the videos filed in it. Built once from a directory walk
+// and the cache, then kept up to date by the model, so views never touch the disk.
+// The rows of a node are its subcategories first, by name, then its videos, oldest first,
+// which is the order the views show: the proxy model only filters. Each video carries its
+// creation time as a precomputed sort key and its MetadataTable row, which indexes the
+// model's per-row caches. This class does no model notifications, the model
+// wraps every change in the begin/end calls.
+class CategoryTree
+{
+public:
+    struct Node {
+        Node *parent{nullptr};
+        CategoryTable::Id id{0};
+        QString name;
+        QList<Node *> dirs;
+        QStringList videos;
+        QList<int> tableRows; // parallel to videos
+        QList<qint64> sortKeys; // parallel to videos, creation time in ms since epoch
+        // key -> index in videos. Rebuilt on the first lookup after videos changed, so a
+        // batch of lookups costs one pass however long the category is.
+        mutable QHash<QString, int> keySlots;
+        mutable bool keySlotsValid{false};
+
+        ~Node() { qDeleteAll(dirs); }
+        int rowCount() const { return int(dirs.size() + videos.size()); }
+        int row() const { return parent ? int(parent->dirs.indexOf(this)) : 0; }
+        int videoSlot(const QString &key) const; // index in videos, -1 if not listed
+        int videoRow(const QString &key) const;
+        bool isDir(int row) const { return row < dirs.size(); }
+    };
+
+    void reset(const QString &rootPath = QString()); // root node only, or nothing
+    void scan(); // every non hidden directory below the root
+
+    // The invisible parent of the root node, so that the root gets an index of its own
+    const Node *top() const { return &m_top; }
+    Node *top() { return &m_top; }
+    Node *root() const { return m_top.dirs.value(0); }
+    Node *node(CategoryTable::Id id) const { return m_nodes.value(id); }
+    Node *node(const QString &path) const;
+    Node *videoNode(const QString &key) const { return m_placed.value(key); }
+    qsizetype videoCount() const { return m_placed.size(); }
+
+    Node *ensure(const QString &path); // with the missing ancestors, nullptr outside the root
+    Node *addCategory(Node *parent, const QString &path); // at dirSlot()
+    void removeCategory(Node *n); // with everything below it
+    void moveCategory(Node *n, Node *newParent); // at dirSlot()
+    void insertVideo(Node *n, int slot, const QString &key, int tableRow, qint64 sortKey);
+    void appendVideo(Node *n, const QString &key, int tableRow, qint64 sortKey); // unsorted, see sortVideos()
+    void removeVideo(const QString &key);
+    void removeVideos(Node *n, int slot, int count); // videos [slot, slot + count)
+    QList<int> sortVideos(Node *n); // the old position of each video, by new position
+
+    // Where a subcategory or a video goes to keep the order, as an index in dirs and videos
+    static int dirSlot(const Node *parent, const QString &name);
+    static int videoSlot(const Node *n, qint64 sortKey);
+
+private:
+    void forget(Node *n);
+
+    Node m_top;
+    QHash<CategoryTable::Id, Node *> m_nodes;
+    QHash<QString, Node *> m_placed; // video key -> node listing it
+};
+
+#endif // CATEGORYTREE_H
@@ -18,9 +18,25 @@ In addition to the above,
 #include "ChannelMetadata.h"
 
 #include <QFile>
+#include <QSaveFile>
 #include <QFileInfo>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QCborStreamWriter>
+#include <QCborStreamReader>
+#include <QTimeZone>
+
+namespace {
+// Keys of the CBOR record map. Append only, readers skip keys they don't know.
+enum CborField : quint64 {
+    VersionField = 0,
+    NameField,
+    IdField,
+    CreationDateField, // msecs since epoch, UTC
+    VendorField,
+    ThumbnailField // raw bytes
+};
+}
 
 ChannelMetadata ChannelMetadata::create(const QString &id,
                                         const QString &name,
@@ -70,7 +86,7 @@ QString ChannelMetadata::filePath() const {
 void ChannelMetadata::setName(const QString &n) {
     if (name == n)
         return;
-    dirty = true;
+    markDirty();
     name = n;
 }
 
@@ -78,14 +94,10 @@ void ChannelMetadata::setThumbnail(const QByteArray &ba) {
     if (!ba.size())
         return;
     thumbnailData = ba;
-    dirty = true;
+    markDirty();
 }
 
-void ChannelMetadata::saveFile() {
-    if (!dirty)
-        return;
-    dirty = false;
-
+QVariantMap ChannelMetadata::toVariantMap() const {
     QVariantMap m;
     m["name"] = name;
     m["id"] = id;
@@ -93,50 +105,152 @@ void ChannelMetadata::saveFile() {
     m["vendor"] = Platform::toString(vendor);
     if (thumbnailData.size())
         m["thumbnail"] = QString::fromLatin1(thumbnailData.toBase64());
+    return m;
+}
 
-    QJsonDocument d = QJsonDocument::fromVariant(m);
-    QFile f(filePath());
+void ChannelMetadata::fromVariantMap(const QVariantMap &m) {
+    name = m.value("name").toString();
+    id = m.value("id").toString();
+    if (m.contains("creationDate")) {
+        creationDate = m.value("creationDate").toDateTime();
+    }
+    if (m.contains("thumbnail")) {
+        thumbnailData = QByteArray::fromBase64(m.value("thumbnail").toString().toLatin1());
+    }
+    if (m.contains("vendor")) {
+        vendor = Platform::toVendor(m.value("vendor").toString());
+    }
+    dirty = false;
+}
 
-    if (!f.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
-        qWarning() << "Failed opening "<<filePath() << " for writing.";
+void ChannelMetadata::markDirty() {
+    dirty = true;
+}
+
+QByteArray ChannelMetadata::toJson() const {
+    return QJsonDocument::fromVariant(toVariantMap()).toJson();
+}
+
+QByteArray ChannelMetadata::toCbor() const {
+    const bool hasDate = creationDate.isValid();
+    const bool hasThumbnail = thumbnailData.size();
+
+    QByteArray out;
+    QCborStreamWriter w(&out);
+    w.append(QCborKnownTags::Signature);
+    w.startMap(4 + hasDate + hasThumbnail);
+    w.append(quint64(VersionField));
+    w.append(RecordFormat::cborVersion);
+    w.append(quint64(NameField));
+    w.append(name);
+    w.append(quint64(IdField));
+    w.append(id);
+    w.append(quint64(VendorField));
+    w.append(Platform::toString(vendor));
+    if (hasDate) {
+        w.append(quint64(CreationDateField));
+        w.append(creationDate.toMSecsSinceEpoch());
+    }
+    if (hasThumbnail) {
+        w.append(quint64(ThumbnailField));
+        w.append(thumbnailData);
+    }
+    w.endMap();
+    return out;
+}
+
+bool ChannelMetadata::fromCbor(const QByteArray &data) {
+    QCborStreamReader r(data);
+    if (r.isTag() && r.toTag() == QCborTag(QCborKnownTags::Signature))
+        r.next();
+    if (!r.isMap() || !r.enterContainer())
+        return false;
+
+    while (r.hasNext() && r.lastError() == QCborError::NoError) {
+        switch (RecordFormat::readInteger(r)) {
+        case VersionField:
+            if (quint64(RecordFormat::readInteger(r)) > RecordFormat::cborVersion) {
+                qWarning() << "Unsupported record version in " << filePath();
+                return false;
+            }
+            break;
+        case NameField:
+            name = RecordFormat::readString(r);
+            break;
+        case IdField:
+            id = RecordFormat::readString(r);
+            break;
+        case CreationDateField:
+            creationDate = QDateTime::fromMSecsSinceEpoch(RecordFormat::readInteger(r), QTimeZone::UTC);
+            break;
+        case VendorField:
+            vendor = Platform::toVendor(RecordFormat::readString(r));
+            break;
+        case ThumbnailField:
+            thumbnailData = RecordFormat::readBytes(r);
+            break;
+        default:
+            r.next();
+            break;
+        }
+    }
+    if (r.lastError() != QCborError::NoError || !r.leaveContainer())
+        return false;
+    dirty = false;
+    return true;
+}
+
+QByteArray ChannelMetadata::serialize(RecordFormat::Format format) const {
+    return (format == RecordFormat::Cbor) ? toCbor() : toJson();
+}
+
+void ChannelMetadata::saveFile(RecordFormat::Format format) {
+    if (!dirty || journaled)
+        return;
+    dirty = false;
+
+    QSaveFile f(filePath());
+    const QIODevice::OpenMode mode = (format == RecordFormat::Cbor)
+                                         ? QIODevice::WriteOnly
+                                         : QIODevice::WriteOnly | QIODevice::Text;
+    if (!f.open(mode)) {
+        qWarning() << "Failed opening file " << f.fileName() << " for writing.";
         return;
     }
-    f.write(d.toJson());
-    f.close();
+    f.write(serialize(format));
+    if (!f.commit())
+        qWarning() << "Failed writing " << f.fileName() << " : " << f.errorString();
 }
 
-void ChannelMetadata::loadFile() {
+bool ChannelMetadata::loadFile() {
     QFile f(filePath());
     if (!f.exists()) {
         qWarning() << f.fileName() << "does not exist.";
-        return;
+        return false;
     }
-    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (!f.open(QIODevice::ReadOnly)) {
         qWarning() << "Failed opening file " << f.fileName()<< " for reading.";
-        return;
+        return false;
     }
-    QString data = f.readAll();
+    const QByteArray data = f.readAll();
     f.close();
 
-    QJsonDocument d = QJsonDocument::fromJson(data.toUtf8());
-    QVariant v = d.toVariant();
-    QVariantMap m = v.toMap();
-
-    name = m.value("name").toString();
-    id = m.value("id").toString();
-    if (m.contains("creationDate")) {
-        creationDate = m.value("creationDate").toDateTime();
+    bool ok = true;
+    if (RecordFormat::isCbor(data)) {
+        ok = fromCbor(data);
+    } else {
+        QJsonParseError error;
+        const QJsonDocument doc = QJsonDocument::fromJson(data, &error);
+        ok = error.error == QJsonParseError::NoError && doc.isObject();
+        if (ok)
+            fromVariantMap(doc.toVariant().toMap());
     }
+    if (!ok)
+        qWarning() << "Failed decoding " << f.fileName();
+
     if (!creationDate.isValid()) {
         QFileInfo check_file(f);
         creationDate = check_file.birthTime().toUTC();
     }
-    if (m.contains("thumbnail")) {
-        thumbnailData = QByteArray::fromBase64(m.value("thumbnail").toString().toLatin1());
-    }
-    if (m.contains("vendor")) {
-        vendor = Platform::toVendor(m.value("vendor").toString());
-    }
-
-    dirty = false;
+    return ok;
 }
@@ -19,12 +19,14 @@ In addition to the above,
 #define CHANNELMETADATA_H
 
 #include "Platform.h"
+#include "RecordFormat.h"
 
 #include <QString>
 #include <QPair>
 #include <QDir>
 #include <QByteArray>
 #include <QDateTime>
+#include <QVariantMap>
 
 struct ChannelMetadata
 {
@@ -37,6 +39,7 @@ struct ChannelMetadata
     QDateTime creationDate;
     Platform::Vendor vendor{Platform::YTB};
     bool dirty{false};
+    bool journaled{false}; // content lives in the root journal, no .yaycc file
 
     static ChannelMetadata create(const QString &id,
                                   const QString &name,
@@ -53,8 +56,15 @@ struct ChannelMetadata
     QString filePath() const;
     void setName(const QString &n);
     void setThumbnail(const QByteArray &ba);
-    void saveFile();
-    void loadFile();
+    QVariantMap toVariantMap() const;
+    void fromVariantMap(const QVariantMap &m);
+    void markDirty();
+    QByteArray toJson() const;
+    QByteArray toCbor() const;
+    bool fromCbor(const QByteArray &data);
+    QByteArray serialize(RecordFormat::Format format) const;
+    void saveFile(RecordFormat::Format format = RecordFormat::Json);
+    bool loadFile(); // false if missing, unreadable or undecodable
 };
 
 #endif // CHANNELMETADATA_H
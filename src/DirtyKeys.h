@@ -0,0 +1,77 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#ifndef DIRTYKEYS_H
+#define DIRTYKEYS_H
+
+#include <QSet>
+#include <QString>
+#include <functional>
+#include <utility>
+
+// Keys of the records changed since the last sync, so flushing only visits what changed.
+// The model adds them through DirtyGuard, records do not point back at their model.
+// onAdded runs once per newly dirty key, not per modification.
+class DirtyKeys
+{
+    QSet<QString> m_keys;
+
+public:
+    std::function<void()> onAdded;
+
+    void insert(const QString &key)
+    {
+        if (m_keys.contains(key))
+            return;
+        m_keys.insert(key);
+        if (onAdded)
+            onAdded();
+    }
+
+    bool remove(const QString &key) { return m_keys.remove(key); }
+    QSet<QString> take() { return std::exchange(m_keys, {}); }
+    qsizetype size() const { return m_keys.size(); }
+    bool isEmpty() const { return m_keys.isEmpty(); }
+};
+
+// Mutable access to a record of a model cache, e.g. editEntry(key)->setViewed(true).
+// If the record is dirty once the access ends, its key goes to the model's DirtyKeys.
+// Records are copied freely (snapshots, exports, worker threads), so they cannot
+// report themselves.
+template <typename Record>
+class DirtyGuard
+{
+    Record &m_record;
+    QString m_key;
+    DirtyKeys &m_keys;
+
+public:
+    DirtyGuard(Record &record, const QString &key, DirtyKeys &keys)
+        : m_record(record), m_key(key), m_keys(keys) {}
+    DirtyGuard(const DirtyGuard &) = delete;
+    DirtyGuard &operator=(const DirtyGuard &) = delete;
+    ~DirtyGuard()
+    {
+        if (m_record.dirty)
+            m_keys.insert(m_key);
+    }
+
+    Record *operator->() const { return &m_record; }
+    Record &operator*() const { return m_record; }
+};
+
+#endif // DIRTYKEYS_H
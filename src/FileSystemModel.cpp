@@ -16,8 +16,10 @@ In addition to the above,
 */
 
 #include "FileSystemModel.h"
+#include "CacheSnapshot.h"
 #include "ThumbnailFetcher.h"
 #include "ThumbnailImageProvider.h"
+#include "ThumbnailStore.h"
 #include "YaycUtilities.h"
 
 #include <QQmlApplicationEngine>
@@ -27,6 +29,18 @@ In addition to the above,
 #include <QLoggingCategory>
 #include <QDirIterator>
 #include <QIdentityProxyModel>
+#include <QThreadPool>
+#include <QThread>
+#include <QJsonDocument>
+#include <QSet>
+#include <QSaveFile>
+#include <QPointer>
+#include <QCoreApplication>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <vector>
 
 // Helper functions
 QString sizeString(const QFileInfo &fi)
@@ -109,42 +123,97 @@ QFileInfoList findFiles(const QDir &d, const QString &ext)
     return hitList;
 }
 
-QHash<QString, VideoMetadata> cacheRoot(const QDir &d)
+namespace {
+void cacheVideoFile(const QFileInfo &f, QHash<QString, VideoMetadata> &res)
 {
-    QHash<QString, VideoMetadata> res;
-    const auto &files = findFiles(d, videoExtension);
-    for (const auto &f : files) {
-        const QString &key = f.baseName();
-        const QString &vtype = videoType(key);
-        if (!((vtype == QLatin1String("s_") || vtype == QLatin1String("v_")) &&
-              f.fileName().endsWith(videoExtension))) {
-            continue;
-        }
-        const QDir parent = f.dir();
-        res.insert(key, VideoMetadata(key, parent));
-        res[key].loadFile();
+    const QString &key = f.baseName();
+    const QString &vtype = videoType(key);
+    if (!((vtype == QLatin1String("s_") || vtype == QLatin1String("v_")) &&
+          f.fileName().endsWith(videoExtension))) {
+        return;
     }
-    return res;
+    res.insert(key, VideoMetadata(key, CategoryTable::intern(f.absolutePath())));
+    res[key].loadFile();
 }
 
-QHash<QString, ChannelMetadata> cacheChannels(QDir d)
+void cacheChannelFile(const QFileInfo &f, const QDir &channelsDir,
+                      QHash<QString, ChannelMetadata> &res)
 {
-    QHash<QString, ChannelMetadata> res;
-    if (!d.cd(".channels")) {
-        qWarning() << "Failed cd into .channels!";
+    const QString &key = f.fileName().chopped(channelExtension.length() + 1);
+    if (!f.fileName().endsWith(channelExtension))
+        return;
+    res.insert(key, ChannelMetadata(key, channelsDir));
+    res[key].loadFile();
+}
+
+// The directory walk happens on the calling thread; parsing is spread over a pool of
+// workers, each filling its own hash, and the partial hashes are merged at the end.
+template <typename Metadata, typename Loader>
+QHash<QString, Metadata> loadFiles(const QFileInfoList &files, int threads, Loader load)
+{
+    if (threads <= 0)
+        threads = QThread::idealThreadCount();
+    // A few chunks per thread evens out directories with very different file sizes
+    const qsizetype chunks = qMin<qsizetype>(files.size(), qsizetype(threads) * 4);
+
+    QHash<QString, Metadata> res;
+    if (threads == 1 || chunks <= 1) {
+        for (const auto &f : files)
+            load(f, res);
         return res;
     }
-    const auto &files = findFiles(d, channelExtension);
-    for (const auto &f : files) {
-        const QString &key = f.fileName().chopped(channelExtension.length() + 1);
-        if (!f.fileName().endsWith(channelExtension)) {
-            continue;
+
+    std::vector<QHash<QString, Metadata>> partial(chunks);
+    {
+        QThreadPool pool;
+        pool.setMaxThreadCount(threads);
+        for (qsizetype c = 0; c < chunks; ++c) {
+            QHash<QString, Metadata> *slot = &partial[c];
+            pool.start([&files, &load, slot, c, chunks]() {
+                for (qsizetype i = c; i < files.size(); i += chunks)
+                    load(files.at(i), *slot);
+            });
         }
-        res.insert(key, ChannelMetadata(key, d));
-        res[key].loadFile();
+        pool.waitForDone();
     }
+
+    res.reserve(files.size());
+    for (const auto &p : partial)
+        res.insert(p);
     return res;
 }
+} // namespace
+
+QHash<QString, VideoMetadata> cacheRoot(const QDir &d, int threads)
+{
+    return loadFiles<VideoMetadata>(findFiles(d, videoExtension), threads, cacheVideoFile);
+}
+
+// Non recursive counterpart of cacheRoot, for refreshing a set of categories
+QHash<QString, VideoMetadata> cacheDirectories(const QList<QDir> &dirs, int threads)
+{
+    QFileInfoList files;
+    for (const auto &d : dirs)
+        files += d.entryInfoList(QStringList() << "*." + videoExtension, QDir::Files);
+    return cacheFiles(files, threads);
+}
+
+QHash<QString, VideoMetadata> cacheFiles(const QFileInfoList &files, int threads)
+{
+    return loadFiles<VideoMetadata>(files, threads, cacheVideoFile);
+}
+
+QHash<QString, ChannelMetadata> cacheChannels(QDir d, int threads)
+{
+    if (!d.cd(".channels")) {
+        qWarning() << "Failed cd into .channels!";
+        return {};
+    }
+    const auto load = [d](const QFileInfo &f, QHash<QString, ChannelMetadata> &res) {
+        cacheChannelFile(f, d, res);
+    };
+    return loadFiles<ChannelMetadata>(findFiles(d, channelExtension), threads, load);
+}
 
 // FileSystemModel implementation
 QVariant FileSystemModel::rootPathIndex() const {
@@ -158,31 +227,65 @@ QVariant FileSystemModel::sortFilterProxyModel() const {
 FileSystemModel::FileSystemModel(QString contextPropertyName,
                                  bool bookmarks,
                                  QObject *parent)
-    : QFileSystemModel(parent),
+    : QAbstractItemModel(parent),
       m_bookmarksModel(bookmarks),
       m_contextPropertyName(contextPropertyName)
 {
     if (m_contextPropertyName.isEmpty()) {
         qFatal("Empty contextPropertyName not supported");
     }
-    QStringList filters;
-    filters << "*." + videoExtension;
-
-    setNameFilters(filters);
-    setNameFilterDisables(false);
-    setFilter(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::AllDirs);
-    sort(3);
     QScopedPointer<NoDirSortProxyModel> pm(new NoDirSortProxyModel);
     auto pmName = m_contextPropertyName + "_ProxyModel";
     pm->setObjectName(pmName.toStdString().c_str());
+    pm->setFilterRole(FilterStateRole); // what rowChanged() sends when a row may pass or fail anew
     m_proxyModel.swap(pm);
+    m_dirtyVideos.onAdded = [this]() { emit unsavedChangesChanged(); };
+    m_dirtyChannels.onAdded = m_dirtyVideos.onAdded;
+    m_writer.reset(new MetadataWriter);
+    connect(m_writer.get(), &MetadataWriter::statusChanged,
+            this, &FileSystemModel::writerStatusChanged);
+    m_positionCommit.setSingleShot(true);
+    m_positionCommit.setInterval(2000);
+    connect(&m_positionCommit, &QTimer::timeout, this, [this]() {
+        if (m_positionLog)
+            m_positionLog->commit();
+    });
+    connect(&m_workingDirs, &WorkingDirIndex::changed, this, [this](const QStringList &keys) {
+        for (const auto &key : keys)
+            workingDirChanged(key, m_workingDirs.root());
+    });
+    m_changeFlush.setSingleShot(true);
+    m_changeFlush.setInterval(16); // a frame
+    connect(&m_changeFlush, &QTimer::timeout, this, &FileSystemModel::flushChanges);
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(5 * 60 * 1000);
+    connect(&m_idleTimer, &QTimer::timeout, this, &FileSystemModel::compactHistory);
     ThumbnailFetcher::registerModel(*this);
 }
 
 FileSystemModel::~FileSystemModel() {
+    if (m_transferCancel)
+        *m_transferCancel = true;
+    settleWrites(); // before the snapshot, the writes touch the directory mtimes it records
+    if (!m_journal && hasValidRoot())
+        CacheSnapshot(m_root).save(m_cache, m_channelCache, m_bookmarksModel);
+    if (hasValidRoot())
+        ThumbnailStore::publish(m_rootPath, thumbnailRefs(m_cache, m_archive.get()));
     ThumbnailFetcher::unregisterModel(*this);
 }
 
+// What the ThumbnailStore has to keep for a root, see ThumbnailStore::collect()
+QSet<QString> FileSystemModel::thumbnailRefs(const QHash<QString, VideoMetadata> &videos,
+                                             const HistoryArchive *archive) {
+    QSet<QString> res = archive ? archive->thumbnailRefs() : QSet<QString>();
+    res.reserve(res.size() + videos.size());
+    for (const auto &v : videos) {
+        if (!v.thumbnailRef.isEmpty())
+            res.insert(v.thumbnailRef);
+    }
+    return res;
+}
+
 QModelIndex FileSystemModel::setRoot(QString newPath, FileSystemModel *oldModel) {
     if (newPath.startsWith("file://")) {
         newPath = newPath.mid(7);
@@ -198,7 +301,7 @@ QModelIndex FileSystemModel::setRoot(QString newPath, FileSystemModel *oldModel)
     if (!m_proxyModel) {
         qFatal("NULL sortfilter proxy model");
     }
-    if (!rootPath().isEmpty() && (rootPath() != ".")) { // if this is the current fsmodel
+    if (!m_rootPath.isEmpty()) { // if this is the current fsmodel
         FileSystemModel *fsmodel = new FileSystemModel(m_contextPropertyName,
                                                        m_bookmarksModel,
                                                        engine);
@@ -207,7 +310,6 @@ QModelIndex FileSystemModel::setRoot(QString newPath, FileSystemModel *oldModel)
         return fsmodel->setRoot(newPath, this);
     }
 
-    setIconProvider(&m_emptyIconProvider);
     if (newPath.isEmpty()) { // clear the model
         m_ready = true;
         // TODO: deduplicate, through an object destructor?
@@ -224,31 +326,48 @@ QModelIndex FileSystemModel::setRoot(QString newPath, FileSystemModel *oldModel)
         return {};
     }
 
-    m_cache = cacheRoot(m_root);
-    if (m_bookmarksModel) {
+    if (oldModel) // it may still have writes in flight for this very root
+        oldModel->settleWrites();
+    m_recordFormat = RecordFormat::of(m_root);
+    if (m_bookmarksModel)
         m_root.mkdir(".channels");
-        m_channelCache = cacheChannels(m_root);
-    }
-
-    ThumbnailImageProvider *provider =
-        static_cast<ThumbnailImageProvider *>(engine->imageProvider(QLatin1String("videothumbnail")));
-    if (!provider) {
-        qFatal("Unable to retrieve ThumbnailImageProvider");
+    if (MetadataJournal::exists(m_root)) {
+        m_journal.reset(new MetadataJournal(m_root));
+        m_journal->setWriter(m_writer.get());
+        m_journal->load(m_cache, m_channelCache);
+    } else if (!CacheSnapshot(m_root).load(m_cache, m_channelCache, m_bookmarksModel)) {
+        m_cache = cacheRoot(m_root);
+        if (m_bookmarksModel)
+            m_channelCache = cacheChannels(m_root);
     }
-    for (const auto &e : std::as_const(m_cache)) {
-        if (e.hasThumbnail())
-            provider->insert(e.key, e.thumbnailData);
+    m_positionLog.reset(new PositionLog(m_root, m_writer.get()));
+    m_positionLog->replay(m_cache); // leftovers of a crash, newer than any record
+    if (!m_bookmarksModel) {
+        m_archive.reset(new HistoryArchive(m_root));
+        m_archive->readIndex(); // addEntry() needs to know which keys are archived
+        m_idleTimer.start();
     }
-    setResolveSymlinks(true);
+    adoptCache();
 
-    auto res = this->QFileSystemModel::setRootPath(newPath);
+    publishThumbnails(m_cache);
+    m_watcher.reset(new RootWatcher(m_root));
+    connect(m_watcher.get(), &RootWatcher::directoriesChanged,
+            this, &FileSystemModel::applyDirectoryChanges);
+    m_rootPath = QDir::cleanPath(m_root.absolutePath());
+    rebuildTree();
+
+    const QModelIndex res = index(0, 0);
     if (res.isValid()) {
+        // The tree is complete already, the proxy filters it right away. It does not sort:
+        // the tree keeps its rows in display order (see CategoryTree), so a change to a row
+        // never moves it.
+        const bool firstInitialization = !m_ready;
+        m_ready = true;
         m_proxyModel->setSourceModel(this);
         m_proxyModel->setDynamicSortFilter(true);
 //        m_proxyModel->setSortRole(LastModifiedRole);
 //        m_proxyModel->sort(3);
-        m_proxyModel->setSortRole(CreatedRole);
-        m_proxyModel->sort(0);
+        m_proxyModel->sort(-1);
 
 
         m_rootPathIndex = m_proxyModel->mapFromSource(res);
@@ -258,14 +377,13 @@ QModelIndex FileSystemModel::setRoot(QString newPath, FileSystemModel *oldModel)
         engine->rootContext()->setContextProperty(m_contextPropertyName, this);
         if (oldModel)
             oldModel->deleteLater();
-        if (!m_ready)
+        if (firstInitialization)
             emit firstInitializationCompleted(m_root.path());
-        m_ready = true;
         emit sortFilterProxyModelChanged();
         emit rootPathIndexChanged();
         return m_rootPathIndex;
     } else {
-        qFatal("Critical failure in QFileSystemModel::setRootPath");
+        qFatal("Critical failure building the category tree");
     }
     return QModelIndex();
 }
@@ -294,16 +412,16 @@ QString FileSystemModel::title(const QModelIndex &item) const {
 }
 
 QString FileSystemModel::title(const QString &key) const {
-    if (!m_ready || !key.size() || !m_cache.contains(key))
-        return QString();
-    return m_cache.value(key).title;
+    const VideoMetadata *e = entry(key);
+    return e ? e->title : QString();
 }
 
 QString FileSystemModel::categoryName(const QString &key) const {
-    if (!m_ready || !key.size() || !m_cache.contains(key))
+    const VideoMetadata *e = entry(key);
+    if (!e)
         return QString();
-    const auto &dirName = m_cache.value(key).parent.dirName();
-    return (m_cache.value(key).parent.path() == rootPath()) ? "/" : dirName;
+    const QString parent = e->parentPath();
+    return (parent == rootPath()) ? "/" : QDir(parent).dirName();
 }
 
 bool FileSystemModel::isVideoBookmarked(const QString &key) {
@@ -313,11 +431,86 @@ bool FileSystemModel::isVideoBookmarked(const QString &key) {
 }
 
 QString FileSystemModel::creationDate(const QString &key) const {
-    if (!m_ready)
-        return QString();
-    if (!key.size() || !m_cache.contains(key))
+    const VideoMetadata *e = entry(key);
+    if (!e)
         return QString();
-    return m_cache.value(key).creationDate.toString(QStringLiteral("yyyy.MM.dd hh:mm"));
+    return e->creationDate.toString(QStringLiteral("yyyy.MM.dd hh:mm"));
+}
+
+// Tree model over m_tree. The internal pointer of an index is the node of its parent, so
+// videos need no node of their own: the first rows of a node are its subcategories, the
+// others its videos.
+QModelIndex FileSystemModel::index(int row, int column, const QModelIndex &parent) const {
+    const CategoryTree::Node *p = parent.isValid() ? categoryNode(parent) : m_tree.top();
+    if (!p || row < 0 || column != 0 || row >= p->rowCount())
+        return {};
+    return createIndex(row, column, p);
+}
+
+QModelIndex FileSystemModel::parent(const QModelIndex &child) const {
+    if (!child.isValid())
+        return {};
+    return nodeIndex(static_cast<const CategoryTree::Node *>(child.internalPointer()));
+}
+
+int FileSystemModel::rowCount(const QModelIndex &parent) const {
+    if (parent.column() > 0)
+        return 0;
+    const CategoryTree::Node *n = parent.isValid() ? categoryNode(parent) : m_tree.top();
+    return n ? n->rowCount() : 0;
+}
+
+int FileSystemModel::columnCount(const QModelIndex &parent) const {
+    Q_UNUSED(parent)
+    return 1;
+}
+
+// Categories are always expandable, empty or not
+bool FileSystemModel::hasChildren(const QModelIndex &parent) const {
+    return !parent.isValid() || isDir(parent);
+}
+
+bool FileSystemModel::isDir(const QModelIndex &index) const {
+    return index.isValid()
+        && static_cast<const CategoryTree::Node *>(index.internalPointer())->isDir(index.row());
+}
+
+QString FileSystemModel::filePath(const QModelIndex &index) const {
+    if (!index.isValid())
+        return {};
+    if (const CategoryTree::Node *n = categoryNode(index))
+        return CategoryTable::path(n->id);
+    const auto *p = static_cast<const CategoryTree::Node *>(index.internalPointer());
+    return CategoryTable::filePath(p->id, itemKey(index), videoExtension);
+}
+
+QString FileSystemModel::fileName(const QModelIndex &index) const {
+    if (!index.isValid())
+        return {};
+    if (const CategoryTree::Node *n = categoryNode(index))
+        return n->name;
+    return itemKey(index) + QLatin1Char('.') + videoExtension;
+}
+
+// Node of a category index, nullptr for videos
+CategoryTree::Node *FileSystemModel::categoryNode(const QModelIndex &index) const {
+    if (!index.isValid())
+        return nullptr;
+    const auto *p = static_cast<const CategoryTree::Node *>(index.internalPointer());
+    return p->isDir(index.row()) ? p->dirs.at(index.row()) : nullptr;
+}
+
+QModelIndex FileSystemModel::nodeIndex(const CategoryTree::Node *n) const {
+    if (!n || !n->parent) // the invisible top
+        return {};
+    return createIndex(n->row(), 0, n->parent);
+}
+
+QModelIndex FileSystemModel::videoIndex(const QString &key) const {
+    const CategoryTree::Node *n = m_tree.videoNode(key);
+    if (!n)
+        return {};
+    return createIndex(n->videoRow(key), 0, n);
 }
 
 QVariant FileSystemModel::data(const QModelIndex &index, int role) const
@@ -326,100 +519,235 @@ QVariant FileSystemModel::data(const QModelIndex &index, int role) const
         qWarning() << "FileSystemModel::data for role "<<role<< " : invalid index "<<index;
         return QVariant();
     }
-    if (index.isValid() && role >= Qt::UserRole) {
+    switch (role) {
+    // The only roles reading the disk. The views don't ask for them.
+    case SizeRole:
+        return QVariant(sizeString(QFileInfo(filePath(index))));
+    case DisplayableFilePermissionsRole:
+        return QVariant(permissionString(QFileInfo(filePath(index))));
+    case LastModifiedRole:
+        return QVariant(QFileInfo(filePath(index)).lastModified().toString(QStringLiteral("yyyyMMddhhmmss")));
+    case FilePathRole:
+        return filePath(index);
+    case IsDirRole:
+        return isDir(index);
+    default:
+        break;
+    }
+
+    if (const CategoryTree::Node *n = categoryNode(index)) {
         switch (role) {
-        case SizeRole:
-            return QVariant(sizeString(fileInfo(index)));
-        case DisplayableFilePermissionsRole:
-            return QVariant(permissionString(fileInfo(index)));
-        case LastModifiedRole:
-            return QVariant(fileInfo(index).lastModified().toString(QStringLiteral("yyyyMMddhhmmss")));
-        case CreatedRole: {
-            if (isDir(index))
-                return QVariant(fileInfo(index).birthTime().toString(QStringLiteral("yyyyMMddhhmmss")));
-            const QString &key = itemKey(index);
-            if (!m_cache.contains(key))
-                return QVariant(fileInfo(index).birthTime().toString(QStringLiteral("yyyy.MM.dd hh:mm")));
-            return m_cache.value(key).creationDate.toString(QStringLiteral("yyyy.MM.dd hh:mm"));
-        }
-        case UrlStringRole: {
-            if (isDir(index))
-                return {};
-            const QString &key = itemKey(index);
-            if (!m_cache.contains(key))
-                return {};
-            return m_cache.value(key).url();
-        }
-        case KeyRole: {
-            if (!isDir(index))
-                return itemKey(index);
-            return {};
-        }
-        case IsDirRole:
-            return isDir(index);
+        case Qt::DisplayRole:
+        case FileNameRole:
+        case ContentNameRole:
+        case TitleRole:
+            return n->name;
         case VersionRole:
-            if (!isDir(index))
-                return m_versions.value(itemKey(index), 0);
+        case FilterStateRole:
             return 0;
-        case ContentNameRole:
-        case QFileSystemModel::FileNameRole:
-        case Qt::DisplayRole: {
-            switch (index.column()) {
-            case 0: {
-                if (!isDir(index))
-                    return itemKey(index);
-                return QFileSystemModel::data(index, role);
-            }
-            case 3:
-                return QVariant(fileInfo(index).lastModified().toString(QStringLiteral("yyyy.MM.dd hh:mm:ss")));
-            default:
-                return QFileSystemModel::data(index, role);
-            }
-        }
-        case TitleRole: {
-            if (!isDir(index)) {
-                const QString &key = itemKey(index);
-                if (!m_cache.contains(key))
-                    return key; // fallback: show key until cache is populated
-                return m_cache.value(key).title;
-            } else {
-                return QFileSystemModel::data(index, role);
-            }
-        }
-        case ChannelNameRole: {
-            if (!isDir(index)) {
-                const QString &key = itemKey(index);
-                if (!m_cache.contains(key))
-                    return {};
-                auto cid = m_cache.value(key).channelID;
-                auto cVendor = m_cache.value(key).vendor;
-                auto cKey = ChannelMetadata::key(cid, cVendor);
-                if (m_channelCache.contains(cKey)) {
-                    return m_channelCache.value(cKey).name;
-                }
-                return {};
-            }
-            return {};
-        }
-        case ChannelIdRole: {
-            if (!isDir(index)) {
-                const QString &key = itemKey(index);
-                if (!m_cache.contains(key))
-                    return {};
-                return m_cache.value(key).channelID;
-            }
+        default:
             return {};
         }
-        default:
-            break;
+    }
+
+    const auto *p = static_cast<const CategoryTree::Node *>(index.internalPointer());
+    const RowRecord &r = rowRecord(p, index.row() - int(p->dirs.size()));
+    switch (role) {
+    case Qt::DisplayRole:
+    case FileNameRole:
+    case ContentNameRole:
+    case KeyRole:
+        return r.key;
+    case VersionRole:
+        return r.version;
+    case CreatedRole:
+        return r.created;
+    case UrlStringRole:
+        return r.url;
+    case TitleRole:
+        return r.title;
+    case ChannelNameRole:
+        return r.channelName;
+    case ChannelIdRole:
+        return r.channelId;
+    case FilterStateRole:
+        return int(m_table.flags(tableRow(index)));
+    default:
+        return {};
+    }
+}
+
+// Display values of the video at position video of node n, formatted on first use and
+// kept until the record changes (see invalidateRow()), so that scrolling only reads them
+const FileSystemModel::RowRecord &FileSystemModel::rowRecord(const CategoryTree::Node *n, int video) const {
+    const int row = n->tableRows.at(video);
+    if (row >= m_rowRecords.size())
+        m_rowRecords.resize(qMax<qsizetype>(row + 1, m_table.rowCount()));
+    RowRecord &r = m_rowRecords[row];
+    if (r.generation == m_rowGeneration)
+        return r;
+
+    r.generation = m_rowGeneration;
+    r.key = n->videos.at(video);
+    r.version = m_versions.value(VideoKey::fromKey(r.key, VideoKey::Lookup), 0);
+    const VideoMetadata *e = entry(r.key);
+    if (!e) {
+        r.title = r.key; // fallback: show key until cache is populated
+        r.created.clear();
+        r.url.clear();
+        r.channelName.clear();
+        r.channelId.clear();
+        return r;
+    }
+    r.title = e->title;
+    r.created = e->creationDate.toString(QStringLiteral("yyyy.MM.dd hh:mm"));
+    r.url = e->url();
+    const ChannelMetadata *c = channel(ChannelMetadata::key(e->channelID, e->vendor));
+    r.channelName = c ? c->name : QString();
+    r.channelId = e->channelID;
+    return r;
+}
+
+void FileSystemModel::invalidateRow(const QString &key) {
+    const MetadataTable::RowId row = m_table.row(key);
+    if (row >= 0 && row < m_rowRecords.size())
+        m_rowRecords[row].generation = 0;
+}
+
+QList<int> FileSystemModel::findVideos(const QString &term, bool titles, bool channels, bool fuzzy,
+                                       const QList<int> *within) const {
+    ensureSearchIndex();
+    return m_search.find(term, titles, channels, fuzzy, within);
+}
+
+// Taken on the GUI thread, read on a worker: every member is implicitly shared. The table
+// copy keeps its generation, rows changed later have a newer MetadataTable::changedAt().
+// The search index is not built here, but by the first pass that searches.
+FilterSnapshot FileSystemModel::filterSnapshot(const QString &extWorkingDirRoot, bool search) const {
+    FilterSnapshot s;
+    s.table = m_table;
+    s.search = m_search;
+    s.searchGeneration = m_searchGeneration;
+    s.searchIndexed = m_searchIndexed;
+    if (search && !m_searchIndexed) {
+        s.records = m_cache;
+        s.channels = m_channelCache;
+    }
+    if (m_ready && !extWorkingDirRoot.isEmpty()) {
+        m_workingDirs.setRoot(extWorkingDirRoot);
+        s.workingDirs = m_workingDirs.states();
+    }
+    return s;
+}
+
+// On a worker, what ensureSearchIndex() does, over the records of the snapshot
+bool FileSystemModel::buildSearchIndex(FilterSnapshot &s, const std::atomic_bool &cancel) {
+    SearchIndexes search;
+    for (MetadataTable::RowId r = 0; r < s.table.rowCount(); ++r) {
+        if (!(r & 0xfff) && cancel)
+            return false;
+        if (!(s.table.flags(r) & MetadataTable::Live))
+            continue;
+        const QString &key = s.table.key(r);
+        const auto e = s.records.constFind(key);
+        if (e == s.records.constEnd())
+            continue;
+        const auto c = s.channels.constFind(ChannelMetadata::key(e->channelID, e->vendor));
+        search.insert(r, key, e->title, e->channelID,
+                      c != s.channels.constEnd() ? c->name : QString());
+    }
+    s.search = search;
+    s.searchIndexed = true;
+    s.records.clear();
+    s.channels.clear();
+    return true;
+}
+
+// Back on the GUI thread. Rows that changed after the snapshot are indexed again. An index
+// that was reset, or built here, meanwhile wins.
+void FileSystemModel::adoptSearchIndex(const SearchIndexes &search, quint64 tableGeneration,
+                                       quint64 searchGeneration) {
+    if (m_searchIndexed || searchGeneration != m_searchGeneration)
+        return;
+    m_search = search;
+    m_searchIndexed = true;
+    bool changed = false;
+    for (MetadataTable::RowId r = 0; r < m_table.rowCount(); ++r) {
+        if (m_table.changedAt(r) <= tableGeneration)
+            continue;
+        if (m_table.flags(r) & MetadataTable::Live) {
+            changed |= indexRow(m_table.key(r));
+        } else {
+            m_search.remove(r);
+            changed = true;
         }
     }
-    return QFileSystemModel::data(index, role);
+    if (changed)
+        ++m_searchGeneration;
+}
+
+bool FileSystemModel::videoMatches(MetadataTable::RowId row, const QString &term, bool titles,
+                                   bool channels, bool fuzzy) const {
+    const QString &key = m_table.key(row);
+    const VideoMetadata *e = entry(key);
+    if (!e)
+        return SearchIndexes::matches(term, titles, channels, fuzzy, key, {}, {}, {});
+    const ChannelMetadata *c = channel(ChannelMetadata::key(e->channelID, e->vendor));
+    return SearchIndexes::matches(term, titles, channels, fuzzy, key, e->title, e->channelID,
+                                  c ? c->name : QString());
+}
+
+// In row order, so that the postings are only ever appended to
+void FileSystemModel::ensureSearchIndex() const {
+    if (m_searchIndexed)
+        return;
+    m_searchIndexed = true;
+    for (MetadataTable::RowId r = 0; r < m_table.rowCount(); ++r) {
+        if (m_table.flags(r) & MetadataTable::Live)
+            indexRow(m_table.key(r));
+    }
+}
+
+// False when the texts did not change, which is the case for most updates
+bool FileSystemModel::indexRow(const QString &key) const {
+    if (!m_searchIndexed)
+        return false;
+    const MetadataTable::RowId row = m_table.row(key);
+    const VideoMetadata *e = entry(key);
+    if (row < 0 || !e)
+        return false;
+    const ChannelMetadata *c = channel(ChannelMetadata::key(e->channelID, e->vendor));
+    return m_search.insert(row, key, e->title, e->channelID, c ? c->name : QString());
+}
+
+// After a channel got its name or a new one, every video of it shows another name
+void FileSystemModel::reindexChannel(const QString &channelKey) {
+    for (auto it = m_cache.cbegin(); it != m_cache.cend(); ++it) {
+        if (ChannelMetadata::key(it->channelID, it->vendor) != channelKey)
+            continue;
+        indexRow(it.key());
+        m_table.stamp(m_table.row(it.key())); // for filter passes in flight
+        rowChanged(it.key(), {ChannelNameRole, FilterStateRole});
+    }
+    if (m_searchIndexed)
+        ++m_searchGeneration;
+}
+
+// After bulk changes, the next search indexes everything again. Every row is stamped, as
+// any of their texts may have changed.
+void FileSystemModel::resetSearchIndex() {
+    m_search.clear();
+    m_searchIndexed = false;
+    ++m_searchGeneration;
+    for (MetadataTable::RowId r = 0; r < m_table.rowCount(); ++r)
+        m_table.stamp(r);
 }
 
 QHash<int, QByteArray> FileSystemModel::roleNames() const
 {
-    QHash<int, QByteArray> result = QFileSystemModel::roleNames();
+    QHash<int, QByteArray> result = QAbstractItemModel::roleNames();
+    result.insert(FileNameRole, QByteArrayLiteral("fileName"));
+    result.insert(FilePathRole, QByteArrayLiteral("filePath"));
     result.insert(SizeRole, QByteArrayLiteral("size"));
     result.insert(DisplayableFilePermissionsRole, QByteArrayLiteral("displayableFilePermissions"));
     result.insert(LastModifiedRole, QByteArrayLiteral("lastModified"));
@@ -428,10 +756,25 @@ QHash<int, QByteArray> FileSystemModel::roleNames() const
     result.insert(KeyRole, QByteArrayLiteral("key"));
     result.insert(IsDirRole, QByteArrayLiteral("isDirectory"));
     result.insert(VersionRole, QByteArrayLiteral("version"));
+    result.insert(FilterStateRole, QByteArrayLiteral("filterState"));
     result.insert(TitleRole, QByteArrayLiteral("videoTitle"));
     return result;
 }
 
+// Lookups for the read paths. They point into the caches, so nothing is copied. The
+// pointers are valid until the cache is next modified.
+const VideoMetadata *FileSystemModel::entry(const QString &key) const {
+    if (!m_ready || key.isEmpty())
+        return nullptr;
+    auto it = m_cache.constFind(key);
+    return it != m_cache.constEnd() ? &it.value() : nullptr;
+}
+
+const ChannelMetadata *FileSystemModel::channel(const QString &key) const {
+    auto it = m_channelCache.constFind(key);
+    return it != m_channelCache.constEnd() ? &it.value() : nullptr;
+}
+
 QString FileSystemModel::keyFromViewItem(const QModelIndex &item) const {
     //qDebug() << "item model:" << item.model() << "proxy model:" << m_proxyModel.get();
     return key(item);
@@ -447,9 +790,10 @@ QVariant FileSystemModel::videoUrl(QModelIndex item) {
 }
 
 QVariant FileSystemModel::videoUrl(const QString &key) {
-    if (!m_ready || !key.size() || !m_cache.contains(key))
+    const VideoMetadata *e = entry(key);
+    if (!e)
         return QString();
-    return m_cache.value(key).url();
+    return e->url();
 }
 
 void FileSystemModel::openInBrowser(QModelIndex item, const QString &extWorkingDirRoot) {
@@ -500,7 +844,8 @@ void FileSystemModel::openInExternalApp(const QString &key,
         }
     }
 
-    QString url = m_cache.value(key).url(false).toString();
+    const VideoMetadata *e = entry(key);
+    QString url = e->url(false).toString();
     QProcess process;
     process.setProgram(extCommand);
     process.setArguments(QStringList() << url);
@@ -512,17 +857,16 @@ void FileSystemModel::openInExternalApp(const QString &key,
         QLoggingCategory category("qmldebug");
         qCInfo(category) << "openInExternalApp: failed QProcess::startDetached";
     } else {
-        auto idx = index(m_cache.value(key).filePath());
-        emit dataChanged(idx, idx);
+        workingDirChanged(key, extWorkingDirRoot);
     }
 }
 
 void FileSystemModel::bumpVersion(const QString &key) {
     if (!m_ready || key.isEmpty() || !m_cache.contains(key))
         return;
-    ++m_versions[key];
-    auto idx = index(m_cache.value(key).filePath());
-    emit dataChanged(idx, idx, {VersionRole});
+    ++m_versions[VideoKey::fromKey(key)];
+    invalidateRow(key);
+    rowChanged(key, {VersionRole});
     emit versionBumped(key);
 }
 
@@ -564,15 +908,20 @@ void FileSystemModel::enqueueCategoryExternalApp(
     auto index = m_proxyModel->mapToSource(categoryItem);
     if (!index.isValid())
         return;
-    QDir dir(filePath(index));
-    if (!dir.exists())
+    const CategoryTree::Node *category = categoryNode(index);
+    if (!category)
         return;
 
-    const auto files = findFiles(dir, videoExtension);
-    for (const auto &f : files) {
-        const QString &key = f.baseName();
-        if (m_cache.contains(key))
-            m_extAppQueue.enqueue({key, extCommand, extWorkingDirRoot, {}});
+    // The tree lists every video of the category, journaled ones have no file to find
+    QList<const CategoryTree::Node *> pending{category};
+    while (!pending.isEmpty()) {
+        const CategoryTree::Node *n = pending.takeFirst();
+        for (const auto &key : n->videos) {
+            if (m_cache.contains(key))
+                m_extAppQueue.enqueue({key, extCommand, extWorkingDirRoot, {}});
+        }
+        for (const CategoryTree::Node *d : n->dirs)
+            pending.append(d);
     }
     m_extAppTotal = m_extAppQueue.size();
     m_extAppCompleted = 0;
@@ -590,16 +939,19 @@ void FileSystemModel::processNextExtAppRequest() {
     m_extAppRunning = true;
     auto job = m_extAppQueue.dequeue();
     m_currentExtAppKey = job.key;
+    m_currentExtAppWorkingDir = job.workingDir;
 
     QDir d(job.workingDir);
     if (!d.exists()) return processNextExtAppRequest();
     if (!d.exists(job.key) && !d.mkdir(job.key)) return processNextExtAppRequest();
     if (m_cache.contains(job.key))
-        bumpVersion(job.key);
+        workingDirChanged(job.key, job.workingDir);
 
-    QString url = job.url.isEmpty()
-                  ? m_cache.value(job.key).url(false).toString()
-                  : job.url;
+    QString url = job.url;
+    if (url.isEmpty()) {
+        if (const VideoMetadata *e = entry(job.key))
+            url = e->url(false).toString();
+    }
 
     if (!m_extAppProcess) {
         m_extAppProcess = new QProcess(this);
@@ -616,7 +968,7 @@ void FileSystemModel::onExtAppFinished(int exitCode, QProcess::ExitStatus status
     Q_UNUSED(exitCode)
     Q_UNUSED(status)
     m_extAppCompleted++;
-    bumpVersion(m_currentExtAppKey);
+    workingDirChanged(m_currentExtAppKey, m_currentExtAppWorkingDir);
     emit extAppProgressChanged();
     processNextExtAppRequest();
 }
@@ -639,9 +991,11 @@ bool FileSystemModel::deleteEntry(QModelIndex item,
     if (isDir(index)) {
         QDir d(filePath(index));
         if (d.isEmpty()) {
-            res = remove(index); // it does removeRecursively internally
+            res = d.removeRecursively();
+            if (res)
+                removeCategory(categoryNode(index));
         } else {
-            qWarning() << "Category not empty! " << fileInfo(index).baseName();
+            qWarning() << "Category not empty! " << fileName(index);
             res = false;
         }
         return res;
@@ -660,8 +1014,16 @@ bool FileSystemModel::deleteEntry(const QString &key,
     if (deleteStorage_)
         deleteStorage(key, extWorkingDirRoot);
 
+    m_writer->cancel(m_cache.constFind(key)->filePath());
+    if (m_dirtyVideos.remove(key))
+        emit unsavedChangesChanged();
     auto entry = m_cache.take(key);
+    touch(key);
     bool res = entry.eraseFile();
+    if (m_journal)
+        m_journal->erase(key);
+    if (m_archive && m_archive->remove(key)) // kept hot and archived by an interrupted compaction
+        buryArchived({key});
     emit structureChanged();
     return res;
 }
@@ -685,20 +1047,1000 @@ void FileSystemModel::deleteStorage(const QString &key,
         QDir d(extWorkingDirRoot);
         if (d.exists() && d.exists(key)) {
             QDir(d.filePath(key)).removeRecursively();
-            bumpVersion(key);
+            workingDirChanged(key, extWorkingDirRoot);
         }
     }
 }
 
+// Visits only the records reported by markDirty() since the last call.
+// Only serialization happens here, the writer thread does the I/O.
 void FileSystemModel::sync() {
-    for (auto &e : m_cache) {
-        e.saveFile();
+    ThumbnailFetcher::collectGarbage(); // once per session
+    if (m_dirtyVideos.isEmpty() && m_dirtyChannels.isEmpty()) {
+        if (m_positionLog)
+            m_positionLog->checkpoint();
+        return;
+    }
+
+    const auto videoKeys = m_dirtyVideos.take();
+    for (const auto &key : videoKeys) {
+        auto it = m_cache.find(key);
+        if (it == m_cache.end() || !it->dirty) // erased meanwhile
+            continue;
+        if (m_journal)
+            m_journal->append(*it);
+        else if (!it->journaled)
+            m_writer->replace(it->filePath(), it->serialize(m_recordFormat));
+        it->dirty = false;
+    }
+    const auto channelKeys = m_dirtyChannels.take();
+    for (const auto &key : channelKeys) {
+        auto it = m_channelCache.find(key);
+        if (it == m_channelCache.end() || !it->dirty)
+            continue;
+        if (m_journal)
+            m_journal->append(*it);
+        else if (!it->journaled)
+            m_writer->replace(it->filePath(), it->serialize(m_recordFormat));
+        it->dirty = false;
+    }
+    if (m_journal && m_journal->needsCompaction(m_cache.size() + m_channelCache.size()))
+        m_journal->compact(m_cache, m_channelCache);
+    if (m_positionLog) // the records queued above supersede the log
+        m_positionLog->checkpoint();
+    emit unsavedChangesChanged();
+    emit writerStatusChanged();
+}
+
+// After the caches have been (re)loaded in bulk: notes the dirty records and reindexes
+// the table
+void FileSystemModel::adoptCache() {
+    for (auto it = m_cache.cbegin(); it != m_cache.cend(); ++it) {
+        if (it->dirty)
+            m_dirtyVideos.insert(it.key());
+    }
+    for (auto it = m_channelCache.cbegin(); it != m_channelCache.cend(); ++it) {
+        if (it->dirty)
+            m_dirtyChannels.insert(it.key());
+    }
+    m_table.rebuild(m_cache);
+    resetSearchIndex();
+}
+
+// Mirrors the current state of a record into the table and the tree, after each change
+void FileSystemModel::touch(const QString &key) {
+    auto it = m_cache.constFind(key);
+    if (it == m_cache.constEnd()) {
+        unindexVideo(key);
+        unplaceVideo(key);
+    } else {
+        m_table.upsert(it.value());
+        invalidateRow(key); // also when the row id was recycled
+        if (indexRow(key))
+            ++m_searchGeneration;
+        placeVideos({key});
+    }
+}
+
+// touch() for many keys that left the cache
+void FileSystemModel::dropVideos(const QStringList &keys) {
+    for (const auto &key : keys)
+        unindexVideo(key);
+    unplaceVideos(keys);
+}
+
+void FileSystemModel::unindexVideo(const QString &key) {
+    invalidateRow(key);
+    if (m_searchIndexed) {
+        const MetadataTable::RowId row = m_table.row(key);
+        m_search.remove(row);
+        ++m_searchGeneration;
+    }
+    m_table.remove(key);
+}
+
+// One directory walk and one pass over the cache, instead of a stat per row
+void FileSystemModel::rebuildTree() {
+    beginResetModel();
+    m_tree.reset(m_rootPath);
+    m_tree.scan();
+    for (auto it = m_cache.cbegin(); it != m_cache.cend(); ++it) {
+        CategoryTree::Node *n = m_tree.node(it->category);
+        if (!n)
+            n = m_tree.ensure(CategoryTable::path(it->category));
+        if (n)
+            m_tree.appendVideo(n, it.key(), m_table.row(it.key()), sortKey(it.value()));
+    }
+    sortNodes(m_tree.root());
+    endResetModel();
+}
+
+// Node of a category directory, created along with its missing ancestors.
+// Nullptr outside the root.
+CategoryTree::Node *FileSystemModel::insertCategory(const QString &path) {
+    if (CategoryTree::Node *n = m_tree.node(path))
+        return n;
+    if (!path.startsWith(m_rootPath + QLatin1Char('/')))
+        return nullptr;
+    CategoryTree::Node *parent = insertCategory(QFileInfo(path).absolutePath());
+    if (!parent)
+        return nullptr;
+    const int row = CategoryTree::dirSlot(parent, QFileInfo(path).fileName());
+    beginInsertRows(nodeIndex(parent), row, row);
+    CategoryTree::Node *n = m_tree.addCategory(parent, path);
+    endInsertRows();
+    return n;
+}
+
+void FileSystemModel::removeCategory(CategoryTree::Node *n) {
+    if (!n || n == m_tree.root())
+        return;
+    const int row = n->row();
+    beginRemoveRows(nodeIndex(n->parent), row, row);
+    m_tree.removeCategory(n);
+    endRemoveRows();
+}
+
+// Brings the subcategories of path in line with the disk: new directories get a node, with
+// everything below them, and the nodes of directories that went away are dropped
+void FileSystemModel::syncCategories(const QString &path) {
+    CategoryTree::Node *n = insertCategory(path);
+    if (!n)
+        return;
+    QSet<CategoryTable::Id> present;
+    const auto subdirs = QDir(path).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const auto &sub : subdirs) {
+        const QString subPath = sub.absoluteFilePath();
+        if (!m_tree.node(subPath)) {
+            insertCategory(subPath);
+            QDirIterator nested(subPath, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+            while (nested.hasNext())
+                insertCategory(nested.next());
+        }
+        present.insert(CategoryTable::intern(subPath));
+    }
+    const auto children = n->dirs; // removeCategory() edits the list
+    for (CategoryTree::Node *d : children) {
+        if (!present.contains(d->id))
+            removeCategory(d);
+    }
+}
+
+// Lists records in the tree under their current category, moving those that were listed
+// elsewhere. A single row goes straight to its place; several are appended as one range
+// and the category is sorted after, so that a bulk import costs one insertion and one
+// layout change per directory. Keys must be unique.
+void FileSystemModel::placeVideos(const QStringList &keys) {
+    QHash<CategoryTree::Node *, QStringList> added;
+    for (const auto &key : keys) {
+        auto it = m_cache.constFind(key);
+        if (it == m_cache.constEnd()) {
+            unplaceVideo(key);
+            continue;
+        }
+        CategoryTree::Node *n = m_tree.node(it->category);
+        if (!n)
+            n = insertCategory(CategoryTable::path(it->category));
+        CategoryTree::Node *current = m_tree.videoNode(key);
+        if (current == n)
+            continue;
+        if (current)
+            unplaceVideo(key);
+        if (n)
+            added[n].append(key);
+    }
+    for (auto it = added.cbegin(); it != added.cend(); ++it) {
+        CategoryTree::Node *n = it.key();
+        if (it->size() == 1) {
+            const QString &key = it->first();
+            const qint64 k = sortKey(m_cache.value(key));
+            const int slot = CategoryTree::videoSlot(n, k);
+            const int row = int(n->dirs.size()) + slot;
+            beginInsertRows(nodeIndex(n), row, row);
+            m_tree.insertVideo(n, slot, key, m_table.row(key), k);
+            endInsertRows();
+            continue;
+        }
+        const int first = n->rowCount();
+        beginInsertRows(nodeIndex(n), first, first + int(it->size()) - 1);
+        for (const auto &key : it.value())
+            m_tree.appendVideo(n, key, m_table.row(key), sortKey(m_cache.value(key)));
+        endInsertRows();
+        sortVideos(n);
+    }
+}
+
+// Sorts the videos of a category on their keys, moving the persistent indexes along
+void FileSystemModel::sortVideos(CategoryTree::Node *n) {
+    const QPersistentModelIndex parent(nodeIndex(n));
+    emit layoutAboutToBeChanged({parent}, QAbstractItemModel::VerticalSortHint);
+    const QModelIndexList persistent = persistentIndexList();
+    const QList<int> order = m_tree.sortVideos(n);
+    const int dirs = int(n->dirs.size());
+    QList<int> newSlot(order.size());
+    for (int i = 0; i < order.size(); ++i)
+        newSlot[order.at(i)] = i;
+    QModelIndexList from, to;
+    for (const auto &index : persistent) {
+        if (index.internalPointer() != n || index.row() < dirs)
+            continue;
+        from.append(index);
+        to.append(createIndex(dirs + newSlot.at(index.row() - dirs), index.column(), n));
+    }
+    changePersistentIndexList(from, to);
+    emit layoutChanged({parent}, QAbstractItemModel::VerticalSortHint);
+}
+
+// Without notifications, for a tree being reset
+void FileSystemModel::sortNodes(CategoryTree::Node *n) {
+    if (!n)
+        return;
+    m_tree.sortVideos(n);
+    for (CategoryTree::Node *d : std::as_const(n->dirs))
+        sortNodes(d);
+}
+
+qint64 FileSystemModel::sortKey(const VideoMetadata &m) {
+    return m.creationDate.isValid() ? m.creationDate.toMSecsSinceEpoch() : 0;
+}
+
+MetadataTable::RowId FileSystemModel::tableRow(const QModelIndex &index) const {
+    if (!index.isValid())
+        return -1;
+    const CategoryTree::Node *n = static_cast<const CategoryTree::Node *>(index.internalPointer());
+    if (n->isDir(index.row()))
+        return -1;
+    return n->tableRows.at(index.row() - n->dirs.size());
+}
+
+qint64 FileSystemModel::sortKey(const QModelIndex &index) const {
+    if (!index.isValid())
+        return 0;
+    const CategoryTree::Node *n = static_cast<const CategoryTree::Node *>(index.internalPointer());
+    if (n->isDir(index.row()))
+        return 0;
+    return n->sortKeys.at(index.row() - n->dirs.size());
+}
+
+void FileSystemModel::unplaceVideo(const QString &key) {
+    CategoryTree::Node *n = m_tree.videoNode(key);
+    if (!n)
+        return;
+    const int row = n->videoRow(key);
+    beginRemoveRows(nodeIndex(n), row, row);
+    m_tree.removeVideo(key);
+    endRemoveRows();
+}
+
+// One removal per run of adjacent rows, last run first so the slots of the others hold
+void FileSystemModel::unplaceVideos(const QStringList &keys) {
+    QHash<CategoryTree::Node *, QList<int>> removed;
+    for (const auto &key : keys) {
+        if (CategoryTree::Node *n = m_tree.videoNode(key))
+            removed[n].append(n->videoSlot(key));
+    }
+    for (auto it = removed.begin(); it != removed.end(); ++it) {
+        CategoryTree::Node *n = it.key();
+        QList<int> &videoSlots = it.value();
+        std::sort(videoSlots.begin(), videoSlots.end());
+        const int dirs = int(n->dirs.size());
+        for (qsizetype end = videoSlots.size(); end > 0;) {
+            qsizetype begin = end - 1;
+            while (begin > 0 && videoSlots.at(begin - 1) == videoSlots.at(begin) - 1)
+                --begin;
+            const int first = videoSlots.at(begin);
+            const int count = int(end - begin);
+            beginRemoveRows(nodeIndex(n), dirs + first, dirs + first + count - 1);
+            m_tree.removeVideos(n, first, count);
+            endRemoveRows();
+            end = begin;
+        }
+    }
+}
+
+void FileSystemModel::publishThumbnails(const QHash<QString, VideoMetadata> &videos) const {
+    QQmlApplicationEngine *engine = qobject_cast<QQmlApplicationEngine *>(parent());
+    ThumbnailImageProvider *provider = engine
+        ? static_cast<ThumbnailImageProvider *>(engine->imageProvider(QLatin1String("videothumbnail")))
+        : nullptr;
+    if (!provider) {
+        qFatal("Unable to retrieve ThumbnailImageProvider");
     }
-    for (auto &c : m_channelCache) {
-        c.saveFile();
+    for (const auto &e : videos) {
+        if (!e.thumbnailRef.isEmpty())
+            provider->insertRef(e.key, e.thumbnailRef);
+        else if (e.thumbnailData.size())
+            provider->insert(e.key, e.thumbnailData);
     }
 }
 
+// Folds a batch of RootWatcher notifications into the cache. Only directory listings are
+// compared: records whose file left are dropped, or follow it when it shows up in another
+// changed directory, and only files of unknown keys are parsed.
+// Content edits of known files are not picked up, the app owns those. Journaled records
+// have no file, the journal alone decides about them, and neither do records whose file
+// is still to be written.
+void FileSystemModel::applyDirectoryChanges(const QStringList &dirs) {
+    if (!hasValidRoot())
+        return;
+
+    struct Found {
+        CategoryTable::Id category;
+        QFileInfo file;
+    };
+    QSet<CategoryTable::Id> listed;
+    QStringList gone; // with a trailing '/'
+    QHash<QString, Found> found; // key -> file, in the listed directories
+    const auto list = [&](const QDir &d) {
+        const CategoryTable::Id category = CategoryTable::intern(d.absolutePath());
+        listed.insert(category);
+        const auto files = d.entryInfoList({QLatin1String("*.") + videoExtension}, QDir::Files);
+        for (const auto &f : files)
+            found.insert(f.baseName(), {category, f});
+    };
+    for (const auto &path : dirs) {
+        const QDir d(path);
+        if (!d.exists()) {
+            gone.append(path + QLatin1Char('/'));
+            if (CategoryTree::Node *n = m_tree.node(path))
+                removeCategory(n);
+            continue;
+        }
+        syncCategories(path);
+        list(d);
+        // A directory moved or copied in shows up as a single new entry of its parent
+        const auto subdirs = d.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+        for (const auto &sub : subdirs) {
+            const QString subPath = sub.absoluteFilePath();
+            if (m_watcher->isWatched(subPath))
+                continue;
+            m_watcher->watchTree(subPath);
+            list(QDir(subPath));
+            QDirIterator nested(subPath, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+            while (nested.hasNext())
+                list(QDir(nested.next()));
+        }
+    }
+
+    QHash<CategoryTable::Id, bool> affected; // memoized per category
+    const auto isAffected = [&](CategoryTable::Id c) {
+        auto it = affected.constFind(c);
+        if (it != affected.constEnd())
+            return it.value();
+        bool res = listed.contains(c);
+        const QString path = CategoryTable::path(c) + QLatin1Char('/');
+        for (qsizetype i = 0; !res && i < gone.size(); ++i)
+            res = path.startsWith(gone.at(i));
+        affected.insert(c, res);
+        return res;
+    };
+
+    bool changed = false;
+    QStringList dropped;
+    for (auto it = m_cache.begin(); it != m_cache.end();) {
+        const QString key = it.key();
+        const auto f = found.constFind(key);
+        if (it->journaled) { // a file of the key is a leftover placeholder, or not ours
+            if (f != found.constEnd())
+                found.erase(f);
+            ++it;
+            continue;
+        }
+        if (f == found.constEnd()) {
+            if (!isAffected(it->category) || it->dirty || m_writer->isPending(it->filePath())) {
+                ++it;
+                continue;
+            }
+            // Its directory was listed without it, or is gone
+            if (m_dirtyVideos.remove(key))
+                emit unsavedChangesChanged();
+            it = m_cache.erase(it);
+            dropped.append(key);
+            if (m_journal)
+                m_journal->erase(key);
+            changed = true;
+            continue;
+        }
+        if (f->category != it->category && !QFile::exists(it->filePath())) { // moved
+            it->category = f->category;
+            touch(key);
+            changed = true;
+        } // else in place, or a copy that is not ours
+        found.erase(f);
+        ++it;
+    }
+    dropVideos(dropped);
+
+    // Whatever is left are keys the cache doesn't know yet
+    QFileInfoList fresh;
+    for (const auto &f : std::as_const(found)) {
+        const QString &vtype = videoType(f.file.baseName());
+        if ((vtype == QLatin1String("s_") || vtype == QLatin1String("v_")) && f.file.size()) // not a placeholder
+            fresh.append(f.file);
+    }
+    if (!fresh.isEmpty()) {
+        auto loaded = cacheFiles(fresh);
+        for (auto it = loaded.begin(); it != loaded.end(); ++it) {
+            if (m_journal) { // absorbed like importFiles() does
+                it->journaled = true;
+                m_journal->append(it.value());
+                QFile::remove(it->filePath());
+            }
+            m_cache.insert(it.key(), it.value());
+            touch(it.key());
+        }
+        publishThumbnails(loaded);
+        changed = true;
+    }
+
+    if (changed)
+        emit structureChanged();
+}
+
+// Queues whatever is dirty and blocks until it is on disk. For operations on the whole root
+// (conversions, imports, switching roots) and shutdown. Single records use
+// MetadataWriter::cancel() instead.
+void FileSystemModel::settleWrites() {
+    sync();
+    m_writer->waitForDone();
+}
+
+FileSystemModel::StorageEngine FileSystemModel::storageEngine() const {
+    return m_journal ? JournalStorage : FileStorage;
+}
+
+// Converts the current root in place. Switching to JournalStorage writes one compacted
+// journal and removes the .yayc files; switching back rewrites the files in full and
+// drops the journal.
+void FileSystemModel::setStorageEngine(StorageEngine engine) {
+    if (!hasValidRoot() || engine == storageEngine())
+        return;
+    settleWrites();
+
+    if (engine == JournalStorage) {
+        QScopedPointer<MetadataJournal> journal(new MetadataJournal(m_root));
+        if (!journal->compact(m_cache, m_channelCache))
+            return;
+        for (auto &e : m_cache) {
+            e.journaled = true;
+            e.dirty = false;
+            QFile::remove(e.filePath());
+        }
+        for (auto &c : m_channelCache) {
+            c.journaled = true;
+            c.dirty = false;
+            QFile::remove(c.filePath());
+        }
+        m_journal.swap(journal);
+        m_journal->setWriter(m_writer.get());
+    } else {
+        for (auto &e : m_cache) {
+            e.journaled = false;
+            e.dirty = true;
+            e.saveFile(m_recordFormat);
+        }
+        for (auto &c : m_channelCache) {
+            c.journaled = false;
+            c.dirty = true;
+            c.saveFile(m_recordFormat);
+        }
+        m_journal->remove();
+        m_journal.reset();
+    }
+    emit storageEngineChanged();
+}
+
+FileSystemModel::RecordEncoding FileSystemModel::recordEncoding() const {
+    return RecordEncoding(m_recordFormat);
+}
+
+// Rewrites the records of the current root in the new encoding. Journaled roots have no
+// record files, there the choice applies once the root is switched back to FileStorage.
+void FileSystemModel::setRecordEncoding(RecordEncoding encoding) {
+    const auto format = RecordFormat::Format(encoding);
+    if (!hasValidRoot() || format == m_recordFormat)
+        return;
+    settleWrites();
+
+    if (RecordFormat::migrate(m_root, format) < 0)
+        return;
+    m_recordFormat = format;
+    emit recordEncodingChanged();
+}
+
+// Absorbs full .yayc files dropped into a journaled root (e.g. copied from another machine)
+// into the journal and removes them. Returns the number of imported records.
+int FileSystemModel::importFiles() {
+    if (!hasValidRoot() || !m_journal)
+        return 0;
+    settleWrites();
+
+    int imported = 0;
+    const auto &files = findFiles(m_root, videoExtension);
+    for (const auto &f : files) {
+        if (!f.size()) { // placeholder left by an older version
+            if (m_cache.contains(f.baseName()))
+                QFile::remove(f.absoluteFilePath());
+            continue;
+        }
+        const QString &key = f.baseName();
+        const QString &vtype = videoType(key);
+        if (vtype != QLatin1String("s_") && vtype != QLatin1String("v_"))
+            continue;
+
+        VideoMetadata v(key, f.dir());
+        if (!v.loadFile()) // left in place, not absorbed as an empty record
+            continue;
+        v.journaled = true;
+        const VideoMetadata *existing = entry(key);
+        if (existing && existing->filePath() != v.filePath())
+            QFile::remove(existing->filePath());
+        m_journal->append(v);
+        m_cache.insert(key, v);
+        touch(key);
+        QFile::remove(f.absoluteFilePath());
+        ++imported;
+    }
+
+    QDir channelsDir(m_root);
+    if (m_bookmarksModel && channelsDir.cd(".channels")) {
+        const auto &channelFiles = findFiles(channelsDir, channelExtension);
+        for (const auto &f : channelFiles) {
+            const QString &key = f.fileName().chopped(channelExtension.length() + 1);
+            ChannelMetadata c(key, channelsDir);
+            if (!c.loadFile())
+                continue;
+            c.journaled = true;
+            m_journal->append(c);
+            m_channelCache.insert(key, c);
+            QFile::remove(f.absoluteFilePath());
+            ++imported;
+        }
+    }
+
+    if (imported) {
+        ++m_rowGeneration; // channel names
+        resetSearchIndex();
+        emit structureChanged();
+    }
+    return imported;
+}
+
+// Writes the per-file layout (categories as directories, one .yayc per video, .channels/*.yaycc)
+// under destinationPath, regardless of the storage engine in use.
+int FileSystemModel::exportFiles(const QString &destinationPath) const {
+    if (!hasValidRoot())
+        return 0;
+    QDir dest(destinationPath);
+    if (!dest.exists() && !QDir().mkpath(destinationPath))
+        return 0;
+
+    int exported = 0;
+    for (const auto &e : m_cache) {
+        const QString rel = m_root.relativeFilePath(e.parentPath());
+        if (!dest.mkpath(rel))
+            continue;
+        // Exports carry their thumbnails inline, the store is local to this machine
+        QFile f(QDir(dest.absoluteFilePath(rel)).absoluteFilePath(e.key + "." + videoExtension));
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
+            qWarning() << "Failed opening file " << f.fileName() << " for writing.";
+            continue;
+        }
+        f.write(QJsonDocument::fromVariant(e.toVariantMap(true)).toJson());
+        f.close();
+        ++exported;
+    }
+    if (!m_channelCache.isEmpty() && dest.mkpath(".channels")) {
+        const QDir channelsDir(dest.absoluteFilePath(".channels"));
+        for (const auto &c : m_channelCache) {
+            ChannelMetadata out(c);
+            out.channelsRoot = channelsDir;
+            out.journaled = false;
+            out.dirty = true;
+            out.saveFile();
+        }
+    }
+    return exported;
+}
+
+namespace {
+constexpr qint64 transferBatch = 4096; // records per progress report and per merge
+}
+
+// The worker gets implicitly shared copies of the caches, so the GUI thread can keep
+// changing its own while the stream is written.
+bool FileSystemModel::exportLibrary(const QString &path, bool withThumbnails) {
+    if (!hasValidRoot() || m_transferRunning)
+        return false;
+    m_transferRunning = true;
+    m_transferCancel.reset(new std::atomic_bool(false));
+    emit libraryTransferRunningChanged();
+
+    const QHash<QString, VideoMetadata> videos = m_cache;
+    const QHash<QString, ChannelMetadata> channels = m_channelCache;
+    const QDir root = m_root;
+    const auto cancel = m_transferCancel;
+    QPointer<FileSystemModel> self(this);
+    QThreadPool::globalInstance()->start([=]() {
+        const auto report = [self](const auto &f) { // self is only tested on the GUI thread
+            QMetaObject::invokeMethod(qApp, [self, f]() {
+                if (self)
+                    f();
+            }, Qt::QueuedConnection);
+        };
+        QSaveFile f(path);
+        if (!f.open(QIODevice::WriteOnly)) {
+            report([self, e = f.errorString()]() { self->finishTransfer(false, 0, e); });
+            return;
+        }
+        const qint64 total = videos.size() + channels.size();
+        LibraryWriter w(&f, LibraryStream::formatForPath(path), root, withThumbnails);
+        w.header(videos.size(), channels.size());
+        // Every category, so empty ones survive the round trip
+        QDirIterator dirs(root.absolutePath(), QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (dirs.hasNext())
+            w.category(dirs.next());
+
+        qint64 done = 0;
+        for (const auto &v : videos) {
+            w.video(v);
+            if (++done % transferBatch == 0) {
+                if (*cancel)
+                    return; // f is discarded
+                report([self, done, total]() { emit self->libraryTransferProgress(done, total); });
+            }
+        }
+        for (const auto &c : channels) {
+            w.channel(c);
+            ++done;
+        }
+        if (!f.commit()) {
+            report([self, e = f.errorString()]() { self->finishTransfer(false, 0, e); });
+            return;
+        }
+        report([self, done]() { self->finishTransfer(true, done, QString()); });
+    });
+    return true;
+}
+
+// Records are written to disk on the worker and handed over in batches. Keys already in
+// the library are kept as they are. The index and the views are refreshed once at the end.
+bool FileSystemModel::importLibrary(const QString &path) {
+    if (!hasValidRoot() || m_transferRunning)
+        return false;
+    m_transferRunning = true;
+    m_transferCancel.reset(new std::atomic_bool(false));
+    emit libraryTransferRunningChanged();
+    m_watcher->setPaused(true); // the new files are merged directly
+
+    const QHash<QString, VideoMetadata> known = m_cache;
+    const QHash<QString, ChannelMetadata> knownChannels = m_channelCache;
+    const QDir root = m_root;
+    const RecordFormat::Format format = m_recordFormat;
+    const bool journaled = bool(m_journal);
+    const bool withChannels = m_bookmarksModel;
+    const auto cancel = m_transferCancel;
+    QPointer<FileSystemModel> self(this);
+    QThreadPool::globalInstance()->start([=]() {
+        const auto report = [self](const auto &f) { // self is only tested on the GUI thread
+            QMetaObject::invokeMethod(qApp, [self, f]() {
+                if (self)
+                    f();
+            }, Qt::QueuedConnection);
+        };
+        QFile f(path);
+        if (!f.open(QIODevice::ReadOnly)) {
+            report([self, e = f.errorString()]() { self->finishTransfer(false, 0, e); });
+            return;
+        }
+
+        LibraryReader reader(&f, root);
+        QSet<QString> createdDirs;
+        QHash<QString, VideoMetadata> videos;
+        QHash<QString, ChannelMetadata> channels;
+        qint64 total = 0;
+        qint64 done = 0;
+        qint64 imported = 0;
+        const auto flush = [&]() {
+            report([self, videos, channels, done, total]() {
+                self->mergeImported(videos, channels);
+                emit self->libraryTransferProgress(done, total);
+            });
+            videos.clear();
+            channels.clear();
+        };
+        const auto ensureDir = [&](const QString &dir) {
+            if (!createdDirs.contains(dir)) {
+                QDir().mkpath(dir);
+                createdDirs.insert(dir);
+            }
+        };
+
+        for (auto item = reader.next(); item.type != LibraryReader::Item::End; item = reader.next()) {
+            if (*cancel)
+                return;
+            switch (item.type) {
+            case LibraryReader::Item::Header:
+                total = item.videos + item.channels;
+                break;
+            case LibraryReader::Item::Category:
+                ensureDir(item.category);
+                break;
+            case LibraryReader::Item::Video: {
+                ++done;
+                VideoMetadata &v = item.video;
+                if (known.contains(v.key))
+                    break;
+                ensureDir(item.category);
+                v.journaled = journaled;
+                if (!journaled) { // else the record goes to the journal in mergeImported()
+                    v.dirty = true;
+                    v.saveFile(format);
+                }
+                videos.insert(v.key, v);
+                ++imported;
+                break;
+            }
+            case LibraryReader::Item::Channel: {
+                ++done;
+                ChannelMetadata &c = item.channel;
+                if (!withChannels || knownChannels.contains(c.key()))
+                    break;
+                c.journaled = journaled;
+                if (!journaled) {
+                    c.dirty = true;
+                    c.saveFile(format);
+                }
+                channels.insert(c.key(), c);
+                ++imported;
+                break;
+            }
+            case LibraryReader::Item::Error: {
+                flush();
+                report([self, imported, e = reader.errorString()]() { self->finishTransfer(false, imported, e); });
+                return;
+            }
+            default:
+                break;
+            }
+            if (videos.size() + channels.size() >= transferBatch)
+                flush();
+        }
+        flush();
+        report([self, imported]() { self->finishTransfer(true, imported, QString()); });
+    });
+    return true;
+}
+
+void FileSystemModel::mergeImported(QHash<QString, VideoMetadata> videos,
+                                    QHash<QString, ChannelMetadata> channels) {
+    for (auto it = videos.begin(); it != videos.end(); ++it) {
+        if (m_journal)
+            m_journal->append(it.value());
+        m_cache.insert(it.key(), it.value());
+    }
+    for (auto it = channels.begin(); it != channels.end(); ++it) {
+        if (m_journal)
+            m_journal->append(it.value());
+        m_channelCache.insert(it.key(), it.value());
+    }
+    publishThumbnails(videos);
+}
+
+void FileSystemModel::finishTransfer(bool success, qint64 count, const QString &error) {
+    if (!error.isEmpty())
+        qWarning() << "Library transfer failed: " << error;
+    if (m_watcher->isPaused()) { // an import: one reindex and one refresh for all batches
+        QDirIterator dirs(m_rootPath, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while (dirs.hasNext())
+            insertCategory(dirs.next());
+        QStringList imported;
+        for (auto it = m_cache.cbegin(); it != m_cache.cend(); ++it) {
+            if (m_tree.videoNode(it.key()))
+                continue;
+            m_table.upsert(it.value()); // rows already in use keep their id, the tree refers to them
+            imported.append(it.key());
+        }
+        placeVideos(imported);
+        ++m_rowGeneration; // channel names
+        resetSearchIndex();
+        m_watcher->watchTree(m_root.absolutePath());
+        m_watcher->setPaused(false);
+        emit structureChanged();
+    }
+    m_transferRunning = false;
+    emit libraryTransferRunningChanged();
+    emit libraryTransferFinished(success, count, error);
+}
+
+void FileSystemModel::setHotDays(int days) {
+    days = qMax(0, days);
+    if (days == m_hotDays)
+        return;
+    m_hotDays = days;
+    emit hotDaysChanged();
+}
+
+// Entries opened in this session stay hot whatever their age, the others go by accessDate.
+// Only the first call for a key does anything: the position updates that follow the
+// opening of a video neither dirty the record again nor push compaction back.
+void FileSystemModel::noteActivity(const QString &key) {
+    if (!m_archive || m_recentKeys.contains(key))
+        return;
+    if (m_cache.contains(key))
+        editEntry(key)->setAccessDate(QDateTime::currentDateTimeUtc());
+    m_recentKeys.insert(key);
+    m_idleTimer.start();
+}
+
+// Moves history entries not opened for hotDays into the HistoryArchive and returns how many.
+// The segment is written on a worker, and the .yayc files are only removed once it is.
+int FileSystemModel::compactHistory() {
+    if (!hasValidRoot() || !m_archive || m_hotDays <= 0 || m_compacting || m_transferRunning)
+        return 0;
+    const QDateTime cutoff = QDateTime::currentDateTimeUtc().addDays(-m_hotDays);
+    QList<VideoMetadata> cold;
+    for (const auto &e : std::as_const(m_cache)) {
+        const QDateTime &accessed = e.accessDate.isValid() ? e.accessDate : e.creationDate;
+        if (accessed.isValid() && accessed < cutoff && !e.dirty && !m_recentKeys.contains(e.key))
+            cold.append(e);
+    }
+    if (cold.isEmpty())
+        return 0;
+
+    QStringList keys;
+    keys.reserve(cold.size());
+    for (const auto &v : std::as_const(cold)) {
+        m_cache.remove(v.key);
+        if (m_journal)
+            m_journal->erase(v.key);
+        m_archive->insert(v);
+        keys.append(v.key);
+    }
+    dropVideos(keys);
+    m_compacting = true;
+
+    const QString path = m_archive->filePath();
+    const QDir root = m_root;
+    const QString rootPath = m_rootPath;
+    QPointer<FileSystemModel> self(this);
+    QThreadPool::globalInstance()->start([=]() {
+        const bool ok = HistoryArchive::appendSegment(path, root, cold);
+        if (ok && HistoryArchive::segmentCount(path) > HistoryArchive::maxSegments)
+            HistoryArchive::rotate(path, root);
+        // self is only looked at on the GUI thread
+        QMetaObject::invokeMethod(qApp, [self, rootPath, cold, ok]() {
+            if (self)
+                self->finishCompaction(rootPath, cold, ok);
+        }, Qt::QueuedConnection);
+    });
+    emit structureChanged();
+    return int(cold.size());
+}
+
+// Files of the archived records go, except for the entries opened again meanwhile. If the
+// segment could not be written the records come back instead.
+void FileSystemModel::finishCompaction(const QString &rootPath, const QList<VideoMetadata> &cold, bool ok) {
+    m_compacting = false;
+    if (rootPath != m_rootPath || !m_archive)
+        return; // the files stay, they win over the archive next time
+    int archived = 0;
+    for (const auto &v : cold) {
+        if (m_cache.contains(v.key))
+            continue;
+        if (!ok) {
+            restoreArchived(v.key);
+            continue;
+        }
+        m_writer->cancel(v.filePath()); // a write still queued would bring the file back
+        QFile::remove(v.filePath()); // legacy placeholder, for journaled records
+        ++archived;
+    }
+    if (ok)
+        emit historyCompacted(archived);
+}
+
+// The archive file still holds these records: a tombstone keeps them from coming back with
+// the next start, and rotate() drops them for good
+void FileSystemModel::buryArchived(const QStringList &keys) {
+    const QString path = m_archive->filePath();
+    QThreadPool::globalInstance()->start([path, keys]() {
+        HistoryArchive::appendTombstones(path, keys);
+    });
+}
+
+QVariantList FileSystemModel::searchArchive(const QString &term, int limit) {
+    if (!hasValidRoot() || !m_archive || term.isEmpty())
+        return {};
+    m_archive->load();
+
+    QList<const VideoMetadata *> hits;
+    for (const auto &v : m_archive->records()) {
+        if (m_cache.contains(v.key)) // hot again
+            continue;
+        // Same texts as indexRow(): title, channel id and channel name
+        const ChannelMetadata *c = channel(ChannelMetadata::key(v.channelID, v.vendor));
+        if (v.title.contains(term, Qt::CaseInsensitive) || v.channelID.contains(term, Qt::CaseInsensitive)
+            || (c && c->name.contains(term, Qt::CaseInsensitive)))
+            hits.append(&v);
+    }
+    std::sort(hits.begin(), hits.end(), [](const VideoMetadata *a, const VideoMetadata *b) {
+        return a->creationDate > b->creationDate;
+    });
+
+    QVariantList res;
+    for (qsizetype i = 0; i < hits.size() && i < limit; ++i) {
+        const VideoMetadata *v = hits.at(i);
+        const ChannelMetadata *c = channel(ChannelMetadata::key(v->channelID, v->vendor));
+        res.append(QVariantMap{{"key", v->key},
+                               {"title", v->title},
+                               {"channel", v->channelID},
+                               {"channelName", c ? c->name : QString()},
+                               {"creationDate", v->creationDate},
+                               {"position", v->position},
+                               {"duration", v->duration}});
+    }
+    return res;
+}
+
+// Text relevance first. Recent and starred videos get a small bonus, enough to order
+// matches of about the same quality but not to pass a better match.
+int FileSystemModel::rankedSearch(const QString &term, bool titles, bool channels, int limit) {
+    QList<SearchResultModel::Result> results;
+    if (m_ready && !term.trimmed().isEmpty()) {
+        ensureSearchIndex();
+        const auto hits = m_search.words().find(term, titles, channels);
+        const QDateTime now = QDateTime::currentDateTimeUtc();
+        QList<QPair<float, int>> ranked;
+        ranked.reserve(hits.size());
+        for (const auto &h : hits) {
+            const VideoMetadata *e = entry(m_table.key(h.doc));
+            if (!e)
+                continue;
+            const float ageDays = e->creationDate.isValid() ? float(e->creationDate.daysTo(now)) : 3650.0f;
+            const bool starred = m_table.flags(h.doc) & MetadataTable::Starred;
+            const float score = h.score + 0.15f / (1.0f + qMax(0.0f, ageDays) / 180.0f) + (starred ? 0.1f : 0.0f);
+            ranked.append({score, h.doc});
+        }
+        const qsizetype count = qMin<qsizetype>(ranked.size(), qMax(0, limit));
+        std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(),
+                          [](const QPair<float, int> &a, const QPair<float, int> &b) { return a.first > b.first; });
+        results.reserve(count);
+        for (qsizetype i = 0; i < count; ++i) {
+            const QString &key = m_table.key(ranked.at(i).second);
+            const VideoMetadata *e = entry(key);
+            const ChannelMetadata *c = channel(ChannelMetadata::key(e->channelID, e->vendor));
+            results.append({key,
+                            e->title,
+                            c ? c->name : QString(),
+                            e->creationDate.toString(QStringLiteral("yyyy.MM.dd hh:mm")),
+                            ranked.at(i).first,
+                            e->starred});
+        }
+    }
+    const int count = int(results.size());
+    m_searchResults.setResults(std::move(results));
+    return count;
+}
+
+// Brings an archived entry back into the hot tier, in its old category when that still exists
+bool FileSystemModel::restoreArchived(const QString &key) {
+    if (!hasValidRoot() || !m_archive || m_cache.contains(key) || !m_archive->contains(key))
+        return false;
+    VideoMetadata v = m_archive->take(key);
+    buryArchived({key});
+    if (!QDir(v.parentPath()).exists())
+        v.setParent(m_root);
+    v.journaled = bool(m_journal);
+    m_cache.insert(key, v);
+    editEntry(key)->markDirty(); // kept out of compaction until saved, opening it notes activity
+    touch(key);
+    publishThumbnails({{key, v}});
+    saveEntry(key);
+    emit structureChanged();
+    return true;
+}
+
 qreal FileSystemModel::progress(const QString &key) const {
     if (!m_ready)
         return 0;
@@ -707,11 +2049,10 @@ qreal FileSystemModel::progress(const QString &key) const {
         return 0;
     }
 
-    const auto &position = m_cache.value(key).position;
-    const auto &duration = m_cache.value(key).duration;
-    if (duration == 0.)
+    const VideoMetadata *e = entry(key);
+    if (e->duration == 0.)
         return 0.;
-    return position / duration;
+    return e->position / e->duration;
 }
 
 qreal FileSystemModel::duration(const QModelIndex &item) const {
@@ -728,7 +2069,7 @@ qreal FileSystemModel::duration(const QString &key) const {
         qWarning() << "FileSystemModel::duration: Key " << key << " not present!";
         return 0;
     }
-    return m_cache.value(key).duration;
+    return entry(key)->duration;
 }
 
 bool FileSystemModel::isShortVideo(const QModelIndex &item) const {
@@ -752,9 +2093,8 @@ bool FileSystemModel::isViewed(const QModelIndex &item) const {
 }
 
 bool FileSystemModel::isViewed(const QString &key) const {
-    if (!m_ready || !key.size() || !m_cache.contains(key))
-        return false;
-    return m_cache.value(key).viewed;
+    const VideoMetadata *e = entry(key);
+    return e && e->viewed;
 }
 
 void FileSystemModel::viewEntry(const QModelIndex &item, bool viewed) {
@@ -770,9 +2110,10 @@ void FileSystemModel::viewEntry(const QModelIndex &item, bool viewed) {
 void FileSystemModel::viewEntry(const QString &key, bool viewed) {
     if (!m_ready || !key.size() || !m_cache.contains(key))
         return;
-    m_cache[key].setViewed(viewed);
-    auto idx = index(m_cache[key].filePath());
-    emit dataChanged(idx, idx);
+    editEntry(key)->setViewed(viewed);
+    touch(key);
+    bumpVersion(key); // the row icon
+    rowChanged(key, {FilterStateRole});
 }
 
 bool FileSystemModel::isStarred(const QModelIndex &item) const {
@@ -783,9 +2124,8 @@ bool FileSystemModel::isStarred(const QModelIndex &item) const {
 }
 
 bool FileSystemModel::isStarred(const QString &key) const {
-    if (!m_ready || !key.size() || !m_cache.contains(key))
-        return false;
-    return m_cache.value(key).starred;
+    const VideoMetadata *e = entry(key);
+    return e && e->starred;
 }
 
 bool FileSystemModel::hasWorkingDir(const QModelIndex &item, const QString &extWorkingDirRoot) const {
@@ -795,26 +2135,107 @@ bool FileSystemModel::hasWorkingDir(const QModelIndex &item, const QString &extW
     return hasWorkingDir(key, extWorkingDirRoot);
 }
 
+// Answered from m_workingDirs, the first call for a new root walks it once
 int FileSystemModel::hasWorkingDir(const QString &key, const QString &extWorkingDirRoot) const {
-    if (!m_ready || !key.size() || !m_cache.contains(key))
-        return false;
-    QDir d(extWorkingDirRoot);
-    const bool exists = d.exists() && d.exists(key);
-    if (!exists || !d.cd(key))
+    if (!m_ready || !key.size() || !m_cache.contains(key) || extWorkingDirRoot.isEmpty())
+        return 0;
+    m_workingDirs.setRoot(extWorkingDirRoot);
+    const quint8 s = m_workingDirs.state(key);
+    if (!(s & WorkingDirIndex::Exists))
         return 0;
-    return 1 + int(!d.isEmpty());
+    return 1 + int(bool(s & WorkingDirIndex::NonEmpty));
 }
 
 bool FileSystemModel::hasSummary(const QString &key, const QString &extWorkingDirRoot) const {
-    if (!m_ready || !key.size() || !m_cache.contains(key))
-        return false;
-
-    if (!hasWorkingDir(key, extWorkingDirRoot))
+    if (!m_ready || !key.size() || !m_cache.contains(key) || extWorkingDirRoot.isEmpty())
         return false;
+    m_workingDirs.setRoot(extWorkingDirRoot);
+    return m_workingDirs.state(key) & WorkingDirIndex::HasSummary;
+}
 
-    QDirIterator it(extWorkingDirRoot + "/" + key, QStringList() << "*summary*",
-                    QDir::Files, QDirIterator::Subdirectories);
-    return it.hasNext();
+// Brings the index up to date for key, then has the delegates and the saved/unsaved filter
+// read it again: the version bump re-evaluates the row icons, the filter role makes the
+// proxy test the row again.
+void FileSystemModel::workingDirChanged(const QString &key, const QString &extWorkingDirRoot) {
+    if (!m_ready || !m_cache.contains(key))
+        return;
+    m_workingDirs.refresh(extWorkingDirRoot, key);
+    m_table.stamp(m_table.row(key)); // for filter passes in flight
+    bumpVersion(key); // the row icons
+    rowChanged(key, {FilterStateRole}); // the saved/unsaved filter
+}
+
+// Row notifications are collected for a frame and sent as one dataChanged per run of
+// adjacent rows, carrying only the roles that changed. An empty list means all roles.
+void FileSystemModel::rowChanged(const QString &key, const QList<int> &roles) {
+    m_changedRoles[key] |= roles.isEmpty() ? allRoles : roleBits(roles);
+    if (!m_changeFlush.isActive())
+        m_changeFlush.start();
+}
+
+// Bit 0 is Qt::DisplayRole, bit i is Qt::UserRole + i. Anything else means all roles.
+quint32 FileSystemModel::roleBits(const QList<int> &roles) {
+    quint32 bits = 0;
+    for (const int role : roles) {
+        if (role == Qt::DisplayRole)
+            bits |= 1u;
+        else if (role > Qt::UserRole && role < Qt::UserRole + 32)
+            bits |= 1u << (role - Qt::UserRole);
+        else
+            return allRoles;
+    }
+    return bits;
+}
+
+QList<int> FileSystemModel::bitRoles(quint32 bits) {
+    QList<int> roles;
+    if (bits == allRoles)
+        return roles;
+    if (bits & 1u)
+        roles.append(Qt::DisplayRole);
+    for (int i = 1; i < 32; ++i) {
+        if (bits & (1u << i))
+            roles.append(Qt::UserRole + i);
+    }
+    return roles;
+}
+
+void FileSystemModel::flushChanges() {
+    struct Change {
+        CategoryTree::Node *node;
+        quint32 bits;
+        int row;
+    };
+    std::vector<Change> changes;
+    changes.reserve(m_changedRoles.size());
+    for (auto it = m_changedRoles.cbegin(); it != m_changedRoles.cend(); ++it) {
+        CategoryTree::Node *n = m_tree.videoNode(it.key());
+        if (!n) // removed, or filed away, since
+            continue;
+        const int row = n->videoRow(it.key());
+        if (row >= 0)
+            changes.push_back({n, it.value(), row});
+    }
+    m_changedRoles.clear();
+    std::sort(changes.begin(), changes.end(), [](const Change &l, const Change &r) {
+        if (l.node != r.node)
+            return std::less<CategoryTree::Node *>()(l.node, r.node);
+        if (l.bits != r.bits)
+            return l.bits < r.bits;
+        return l.row < r.row;
+    });
+    for (size_t i = 0; i < changes.size();) {
+        size_t last = i;
+        while (last + 1 < changes.size()
+               && changes[last + 1].node == changes[i].node
+               && changes[last + 1].bits == changes[i].bits
+               && changes[last + 1].row == changes[last].row + 1)
+            ++last;
+        emit dataChanged(createIndex(changes[i].row, 0, changes[i].node),
+                         createIndex(changes[last].row, 0, changes[i].node),
+                         bitRoles(changes[i].bits));
+        i = last + 1;
+    }
 }
 
 void FileSystemModel::starEntry(const QModelIndex &item, bool starred) {
@@ -830,9 +2251,10 @@ void FileSystemModel::starEntry(const QModelIndex &item, bool starred) {
 void FileSystemModel::starEntry(const QString &key, bool starred) {
     if (!m_ready || !key.size() || !m_cache.contains(key))
         return;
-    m_cache[key].setStarred(starred);
-    auto idx = index(m_cache[key].filePath());
-    emit dataChanged(idx, idx);
+    editEntry(key)->setStarred(starred);
+    touch(key);
+    bumpVersion(key); // the star icon
+    rowChanged(key, {FilterStateRole});
 }
 
 QString FileSystemModel::videoIconUrl(const QModelIndex &item) const {
@@ -907,10 +2329,14 @@ bool FileSystemModel::moveEntry(QModelIndex item, QModelIndex destinationDir) {
             return false;
         }
         QString newName = d.absoluteFilePath(fileName(index));
+        const QString oldName = f.absolutePath();
+        const QStringList dropped = m_writer->cancelUnder(oldName);
         const bool res = f.rename(f.absoluteFilePath(""), newName);
         if (res) {
-            m_cache = cacheRoot(rootDirectory());
+            relocateCategory(oldName, newName);
+            emit structureChanged();
         }
+        requeueRecords(dropped);
         return res;
     } else {
         const QString &key = itemKey(index);
@@ -949,11 +2375,14 @@ bool FileSystemModel::moveEntry(QModelIndex item, const QString &destinationPath
             return false;
         }
         QString newName = d.absoluteFilePath(fileName(index));
+        const QString oldName = f.absolutePath();
+        const QStringList dropped = m_writer->cancelUnder(oldName);
         const bool res = f.rename(f.absoluteFilePath(""), newName);
         if (res) {
-            m_cache = cacheRoot(rootDirectory());
+            relocateCategory(oldName, newName);
             emit structureChanged();
         }
+        requeueRecords(dropped);
         return res;
     } else {
         const QString &key = itemKey(index);
@@ -972,16 +2401,39 @@ void FileSystemModel::moveEntry(const QString &key, const QString &ds) {
         qWarning() << "Destination directory doesn't exist";
         return;
     }
-    m_cache[key].moveLocation(d);
+    relocateEntry(key, d);
 }
 
 void FileSystemModel::moveEntry(const QString &key, const QDir &d) {
     if (!m_ready || !m_cache.contains(key))
         return;
-    m_cache[key].moveLocation(d);
+    relocateEntry(key, d);
     emit structureChanged();
 }
 
+// Only the writes of this record are cancelled, and queued again at the new path
+void FileSystemModel::relocateEntry(const QString &key, const QDir &d) {
+    auto e = editEntry(key);
+    const QString oldPath = e->filePath();
+    const bool pending = m_writer->cancel(oldPath);
+    if (pending && !QFile::exists(oldPath))
+        e->setParent(d); // never written so far
+    else
+        e->moveLocation(d);
+    if (pending)
+        requeueRecords({e->filePath()});
+    touch(key);
+}
+
+// Queues again, at their current path, the records whose writes MetadataWriter::cancel() dropped
+void FileSystemModel::requeueRecords(const QStringList &paths) {
+    for (const auto &path : paths) {
+        auto it = m_cache.constFind(QFileInfo(path).baseName());
+        if (it != m_cache.cend() && !it->journaled)
+            m_writer->replace(it->filePath(), it->serialize(m_recordFormat));
+    }
+}
+
 bool FileSystemModel::addCategory(const QString &name, QModelIndex parentDir) {
     if (!m_ready)
         return false;
@@ -994,6 +2446,7 @@ bool FileSystemModel::addCategory(const QString &name, QModelIndex parentDir) {
     if (!d.mkdir(name))
         return false;
     QString newPath = d.absoluteFilePath(name);
+    insertCategory(newPath);
     pushRecentDestination(newPath, name);
     emit structureChanged();
     return true;
@@ -1014,14 +2467,29 @@ bool FileSystemModel::updateEntry(const QString &key,
         qWarning() << "Invalid channel parsed: "<<channelID;
         channelID.clear();
     }
-    m_cache[key].setChannelID(channelID);
+    const bool channelChanged = editEntry(key)->setChannelID(channelID);
     if (!channelID.isEmpty() && m_bookmarksModel) {
         addChannel(channelID, Platform::YTB, channelName, channelAvatarURL);
     }
-    bool updated = m_cache[key].update(title, position, duration);
-    if (updated) {
-        auto idx = index(m_cache[key].filePath());
-        emit dataChanged(idx, idx);
+    noteActivity(key);
+    auto e = editEntry(key);
+    const bool moved = e->position != position || e->duration != duration;
+    const bool retitled = e->title != title;
+    bool updated = e->update(title, position, duration);
+    touch(key);
+    if (moved && m_positionLog) {
+        m_positionLog->record(VideoKey::fromKey(key), e->position, e->duration);
+        if (!m_positionCommit.isActive())
+            m_positionCommit.start();
+    }
+    if (updated || channelChanged) {
+        // Progress is polled by the views, position and duration only matter to the filter
+        QList<int> roles{FilterStateRole};
+        if (retitled)
+            roles.append(TitleRole);
+        if (channelChanged)
+            roles << ChannelIdRole << ChannelNameRole;
+        rowChanged(key, roles);
     }
     return true;
 }
@@ -1029,28 +2497,31 @@ bool FileSystemModel::updateEntry(const QString &key,
 void FileSystemModel::updateChannelID(const QString &key, const QString &channelID) {
     if (!m_ready || !m_bookmarksModel || !m_cache.contains(key))
         return;
-    const bool updated = m_cache[key].setChannelID(channelID);
+    const bool updated = editEntry(key)->setChannelID(channelID);
     if (updated) {
-        auto idx = index(m_cache[key].filePath());
-        emit dataChanged(idx, idx);
+        touch(key);
+        rowChanged(key, {ChannelIdRole, ChannelNameRole, FilterStateRole});
     }
 }
 
 void FileSystemModel::updateTitle(const QString &key, const QString &title) {
     if (!m_ready || !m_cache.contains(key) || title.isEmpty())
         return;
-    const bool updated = m_cache[key].setTitle(title);
+    const bool updated = editEntry(key)->setTitle(title);
     if (updated) {
-        auto idx = index(m_cache[key].filePath());
-        emit dataChanged(idx, idx);
+        invalidateRow(key);
+        if (indexRow(key))
+            ++m_searchGeneration;
+        m_table.stamp(m_table.row(key)); // for the filter, also without an index
+        rowChanged(key, {TitleRole, FilterStateRole});
     }
 }
 
 void FileSystemModel::updateChannelAvatar(const QString &channelKey, const QByteArray avatar) {
     if (!m_ready || !m_bookmarksModel || !m_channelCache.contains(channelKey))
         return;
-    m_channelCache[channelKey].setThumbnail(avatar);
-    m_channelCache[channelKey].saveFile();
+    editChannel(channelKey)->setThumbnail(avatar);
+    saveChannel(channelKey);
 }
 
 bool FileSystemModel::addEntry(const QString &key,
@@ -1066,14 +2537,19 @@ bool FileSystemModel::addEntry(const QString &key,
 
     QDir targetDir = (!destination.isEmpty() && QDir(destination).exists())
                          ? QDir(destination)
-                         : rootDirectory();
+                         : m_root;
 
-    if (!m_cache.contains(key))
+    if (!m_cache.contains(key) && m_archive && m_archive->contains(key))
+        restoreArchived(key); // keeps the old position
+    if (!m_cache.contains(key)) {
         m_cache.insert(key, VideoMetadata(key, targetDir));
-    if (!m_cache.value(key).hasThumbnail()) {
+        m_cache[key].journaled = bool(m_journal);
+    }
+    noteActivity(key);
+    if (!entry(key)->hasThumbnail()) {
         fetchThumbnail(key);
     }
-    m_cache[key].update(title, position, duration);
+    editEntry(key)->update(title, position, duration);
 
     if (channelURL.isEmpty()) {
         ThumbnailFetcher::fetchChannel(key);
@@ -1081,7 +2557,7 @@ bool FileSystemModel::addEntry(const QString &key,
         auto channelID = QUrl(channelURL).path().mid(1);
         if (!channelID.startsWith('@'))
             channelID.clear();
-        m_cache[key].setChannelID(channelID);
+        editEntry(key)->setChannelID(channelID);
         if (!channelID.isEmpty() && m_bookmarksModel) {
             addChannel(channelID, Platform::YTB, channelName, channelAvatarURL);
         }
@@ -1090,17 +2566,9 @@ bool FileSystemModel::addEntry(const QString &key,
     if (YaycUtilities::isShortVideo(key) && !channelURL.isEmpty()) {
         m_cache[key].viewed = true;
     }
+    touch(key);
 
-    m_cache[key].saveFile();
-
-    // Pre-fetch the target directory so QQmlTreeModelToTableModel::expandPendingRows()
-    // sees rowCount()==0 + canFetchMore()==true and triggers a full load when expanded,
-    // rather than seeing a partial rowCount>0 and skipping fetchMore().
-    if (targetDir.absolutePath() != m_root.absolutePath()) {
-        const auto dirIdx = QFileSystemModel::index(targetDir.absolutePath());
-        if (dirIdx.isValid() && QFileSystemModel::canFetchMore(dirIdx))
-            QFileSystemModel::fetchMore(dirIdx);
-    }
+    saveEntry(key);
 
     emit structureChanged();
     return true;
@@ -1114,8 +2582,9 @@ void FileSystemModel::reloadCategory(QModelIndex proxyIndex) {
     if (!srcIdx.isValid() || !isDir(srcIdx))
         return;
     const QString path = filePath(srcIdx);
-    QFileSystemModel::fetchMore(srcIdx);
     emit categoryReloadRequested(path);
+    applyDirectoryChanges({path}); // whatever the watcher missed
+    emit directoryLoaded(path);
 }
 
 QString FileSystemModel::categoryPath(QModelIndex proxyIndex) const {
@@ -1140,9 +2609,8 @@ void FileSystemModel::setLastDestinationCategory(QModelIndex categoryIndex) {
     pushRecentDestination(d.path(), d.dirName());
 }
 
-// Category subdirectories of path, sorted by name. Read straight off the disk instead of
-// through QFileSystemModel: no lazy population / fetchMore, and the menu that consumes this
-// rebuilds the level on every open anyway.
+// Category subdirectories of path, sorted by name. Read straight off the disk: the menu
+// that consumes this rebuilds the level on every open anyway.
 QVariantList FileSystemModel::subFolders(const QString &path) const {
     QVariantList result;
     if (!hasValidRoot())
@@ -1230,9 +2698,74 @@ void FileSystemModel::setMaxRecentDestinations(int max) {
     emit maxRecentDestinationsChanged();
 }
 
+// Persists a single record right away, through the journal when the root has one
+void FileSystemModel::saveEntry(const QString &key) {
+    if (!m_cache.contains(key))
+        return;
+    auto &e = m_cache[key];
+    if (m_dirtyVideos.remove(key))
+        emit unsavedChangesChanged();
+    if (!m_journal) {
+        if (e.dirty)
+            m_writer->replace(e.filePath(), e.serialize(m_recordFormat));
+        e.dirty = false;
+        return;
+    }
+    if (!e.dirty)
+        return;
+    m_journal->append(e);
+    e.dirty = false;
+}
+
+void FileSystemModel::saveChannel(const QString &key) {
+    if (!m_channelCache.contains(key))
+        return;
+    auto &c = m_channelCache[key];
+    if (m_dirtyChannels.remove(key))
+        emit unsavedChangesChanged();
+    if (!m_journal) {
+        if (c.dirty)
+            m_writer->replace(c.filePath(), c.serialize(m_recordFormat));
+        c.dirty = false;
+        return;
+    }
+    if (!c.dirty)
+        return;
+    m_journal->append(c);
+    c.dirty = false;
+}
+
+// Records refer to their directory through the CategoryTable, so a directory move only
+// rewrites the rows of the moved subtree. Journaled records also store the category in
+// the journal, so those need a new record.
+void FileSystemModel::relocateCategory(const QString &oldPath, const QString &newPath) {
+    const auto moved = CategoryTable::rename(oldPath, newPath);
+    CategoryTree::Node *n = moved.isEmpty() ? nullptr : m_tree.node(newPath); // same node, new path
+    CategoryTree::Node *newParent = insertCategory(QFileInfo(newPath).absolutePath());
+    if (n && newParent && n->parent != newParent) {
+        const int from = n->row();
+        const int to = CategoryTree::dirSlot(newParent, QFileInfo(newPath).fileName());
+        if (beginMoveRows(nodeIndex(n->parent), from, from, nodeIndex(newParent), to)) {
+            m_tree.moveCategory(n, newParent);
+            endMoveRows();
+        }
+    } else if (!n) {
+        syncCategories(newPath);
+    }
+    if (!m_journal || moved.isEmpty())
+        return;
+    const QSet<CategoryTable::Id> ids(moved.cbegin(), moved.cend());
+    for (auto &e : m_cache) {
+        if (ids.contains(e.category)) {
+            e.markDirty();
+            m_dirtyVideos.insert(e.key);
+        }
+    }
+}
+
 void FileSystemModel::addThumbnail(const QString &key, const QByteArray &thumbnailData) {
-    if (m_cache.contains(key) && !m_cache[key].hasThumbnail()) {
-        m_cache[key].setThumbnail(thumbnailData);
+    if (m_cache.contains(key) && !m_cache[key].thumbnailAvailable()) {
+        editEntry(key)->setThumbnail(thumbnailData);
     }
 }
 
@@ -1242,6 +2775,7 @@ void FileSystemModel::updateChannel(const QString &key,
     Q_UNUSED(channelName)
     if (m_cache.contains(key)) {
         m_cache[key].channelID = channelId;
+        touch(key);
     }
 }
 
@@ -1257,11 +2791,20 @@ void FileSystemModel::addChannel(const QString &channelId,
     bool avatarNeedsFetch = true;
     if (m_channelCache.contains(key)) {
         avatarNeedsFetch = !m_channelCache[key].hasThumbnail();
-        m_channelCache[key].setName(channelName);
+        const QString name = m_channelCache[key].name;
+        editChannel(key)->setName(channelName);
+        if (m_channelCache[key].name != name) {
+            ++m_rowGeneration; // shown by every video of the channel
+            reindexChannel(key);
+        }
     } else {
         QDir d(m_root);
         d.cd(".channels");
         m_channelCache[key] = ChannelMetadata::create(channelId, channelName, vendor, d);
+        m_channelCache[key].journaled = bool(m_journal);
+        editChannel(key)->markDirty();
+        ++m_rowGeneration;
+        reindexChannel(key);
     }
     if (avatarNeedsFetch)
         ThumbnailFetcher::fetchChannelAvatar(key, channelAvatarURL);
@@ -1272,8 +2815,11 @@ QString FileSystemModel::itemKey(const QModelIndex &index) const {
         qWarning() << "FileSystemModel not ready!";
         return QString();
     }
-    const auto &fi = fileInfo(index);
-    return fi.baseName();
+    if (!index.isValid())
+        return QString();
+    const auto *p = static_cast<const CategoryTree::Node *>(index.internalPointer());
+    const int row = index.row() - int(p->dirs.size());
+    return row >= 0 ? p->videos.at(row) : QString();
 }
 
 void FileSystemModel::fetchThumbnail(const QString &key) {
@@ -21,18 +21,48 @@ In addition to the above,
 #include "Platform.h"
 #include "VideoMetadata.h"
 #include "ChannelMetadata.h"
-#include "EmptyIconProvider.h"
+#include "MetadataJournal.h"
+#include "MetadataWriter.h"
+#include "MetadataTable.h"
+#include "RecordFormat.h"
+#include "DirtyKeys.h"
+#include "PositionLog.h"
+#include "RootWatcher.h"
+#include "LibraryStream.h"
+#include "HistoryArchive.h"
+#include "CategoryTree.h"
+#include "WorkingDirIndex.h"
+#include "SearchIndexes.h"
+#include "SearchResultModel.h"
 #include "NoDirSortProxyModel.h"
 
-#include <QFileSystemModel>
+#include <QAbstractItemModel>
+#include <QFileInfo>
 #include <QHash>
 #include <QQueue>
 #include <QDir>
 #include <QScopedPointer>
 #include <QProcess>
+#include <QTimer>
+#include <QSharedPointer>
+#include <atomic>
 
 class ThumbnailFetcher;
 
+// Immutable copy of everything NoDirSortProxyModel filters on, for a filter pass on a worker
+// thread. The members are implicitly shared: taking one is cheap, and the model is free to
+// change meanwhile.
+struct FilterSnapshot {
+    MetadataTable table;
+    SearchIndexes search;
+    quint64 searchGeneration{0};
+    QHash<QString, quint8> workingDirs; // WorkingDirIndex states, empty without a root
+    // Without a search index yet, the records it is built from, see buildSearchIndex()
+    bool searchIndexed{true};
+    QHash<QString, VideoMetadata> records;
+    QHash<QString, ChannelMetadata> channels;
+};
+
 struct ExtAppJob {
     QString key;        // video ID, used for working dir creation and cache lookup
     QString command;    // external app executable to launch
@@ -45,16 +75,47 @@ QString sizeString(const QFileInfo &fi);
 QString permissionString(const QFileInfo &fi);
 QFileInfoList findFile(const QString &fileName, const QDir &d);
 QFileInfoList findFiles(const QDir &d, const QString &ext);
-QHash<QString, VideoMetadata> cacheRoot(const QDir &d);
-QHash<QString, ChannelMetadata> cacheChannels(QDir d);
+// threads <= 0 uses QThread::idealThreadCount(), 1 parses on the calling thread
+QHash<QString, VideoMetadata> cacheRoot(const QDir &d, int threads = 0);
+QHash<QString, VideoMetadata> cacheDirectories(const QList<QDir> &dirs, int threads = 0);
+QHash<QString, VideoMetadata> cacheFiles(const QFileInfoList &files, int threads = 0);
+QHash<QString, ChannelMetadata> cacheChannels(QDir d, int threads = 0);
 
-class FileSystemModel : public QFileSystemModel {
+// Tree of categories and videos of a root, for the QML TreeView (through m_proxyModel).
+// Rows come from m_tree and the roles from the cache, so neither expanding a category nor
+// scrolling touches the disk.
+class FileSystemModel : public QAbstractItemModel {
     Q_OBJECT
 
     bool m_ready{false};
     bool m_bookmarksModel{false};
     QHash<QString, VideoMetadata> m_cache;
     QHash<QString, ChannelMetadata> m_channelCache;
+    DirtyKeys m_dirtyVideos;
+    DirtyKeys m_dirtyChannels;
+    MetadataTable m_table;
+    CategoryTree m_tree;
+    // Display values of a video row, see rowRecord(). Indexed by MetadataTable row id; a
+    // record is current while its generation matches m_rowGeneration.
+    struct RowRecord {
+        quint64 generation{0};
+        QString key;
+        QString title;
+        QString created;
+        QString channelName;
+        QString channelId;
+        QUrl url;
+        int version{0};
+    };
+    mutable QList<RowRecord> m_rowRecords;
+    quint64 m_rowGeneration{1}; // bumped to drop every record at once
+    // Text search, by MetadataTable row id. Built on the worker by the first filter pass that
+    // searches, see buildSearchIndex(), or by the first findVideos(). Then kept up to date
+    // by touch().
+    mutable SearchIndexes m_search;
+    SearchResultModel m_searchResults; // see rankedSearch()
+    mutable bool m_searchIndexed{false};
+    quint64 m_searchGeneration{1};
     QModelIndex m_rootPathIndex;
     QScopedPointer<NoDirSortProxyModel> m_proxyModel;
     QString m_contextPropertyName;
@@ -67,11 +128,27 @@ class FileSystemModel : public QFileSystemModel {
     int m_maxRecentDestinations = 5;
     QList<DestinationCategory> m_recentDestinations;
 
-    EmptyIconProvider m_emptyIconProvider;
     QDir m_root;
+    QString m_rootPath; // clean absolute path of m_root, empty until setRoot()
+    QScopedPointer<MetadataJournal> m_journal; // set when the root uses JournalStorage
+    RecordFormat::Format m_recordFormat{RecordFormat::Json};
+    QScopedPointer<MetadataWriter> m_writer; // all record writes of sync() go through it
+    QScopedPointer<PositionLog> m_positionLog;
+    QTimer m_positionCommit; // group commit of m_positionLog
+    QScopedPointer<RootWatcher> m_watcher; // external changes, see applyDirectoryChanges()
+    QScopedPointer<HistoryArchive> m_archive; // history models only
+    int m_hotDays{90};
+    QTimer m_idleTimer; // compactHistory() once playback has been quiet for a while
+    QHash<QString, quint32> m_changedRoles; // rows to notify, see rowChanged()
+    QTimer m_changeFlush;
+    static constexpr quint32 allRoles = ~quint32(0);
+    bool m_compacting{false};
+    QSet<QString> m_recentKeys; // opened in this session, see noteActivity()
+    bool m_transferRunning{false}; // exportLibrary()/importLibrary()
+    QSharedPointer<std::atomic_bool> m_transferCancel;
 
     inline bool hasValidRoot() const {
-        return m_ready && !rootPath().isEmpty() && rootPath() != ".";
+        return m_ready && !m_rootPath.isEmpty();
     }
 
     QQueue<ExtAppJob> m_extAppQueue;
@@ -79,12 +156,15 @@ class FileSystemModel : public QFileSystemModel {
     bool m_extAppRunning{false};
     int m_extAppTotal{0};
     int m_extAppCompleted{0};
-    QHash<QString, int> m_versions;
+    QHash<VideoKey, int> m_versions;
     QString m_currentExtAppKey;
+    QString m_currentExtAppWorkingDir;
+    mutable WorkingDirIndex m_workingDirs; // follows the root the views ask about
 
     Q_PROPERTY(QVariant sortFilterProxyModel READ sortFilterProxyModel NOTIFY sortFilterProxyModelChanged)
     Q_PROPERTY(QVariant rootPathIndex READ rootPathIndex NOTIFY rootPathIndexChanged)
     Q_PROPERTY(QVariant nullIndex MEMBER m_nullIndex CONSTANT)
+    Q_PROPERTY(QObject *searchResults READ searchResults CONSTANT)
     Q_PROPERTY(QString bookmarksRootPath READ rootPath NOTIFY rootPathIndexChanged)
     Q_PROPERTY(QVariantList recentDestinations READ recentDestinations NOTIFY recentDestinationsChanged)
     // Plain path list, for persistence in the settings file
@@ -94,6 +174,15 @@ class FileSystemModel : public QFileSystemModel {
     Q_PROPERTY(int extAppQueueTotal READ extAppQueueTotal NOTIFY extAppProgressChanged)
     Q_PROPERTY(int extAppQueueCompleted READ extAppQueueCompleted NOTIFY extAppProgressChanged)
     Q_PROPERTY(bool extAppQueueRunning READ extAppQueueRunning NOTIFY extAppProgressChanged)
+    Q_PROPERTY(StorageEngine storageEngine READ storageEngine WRITE setStorageEngine NOTIFY storageEngineChanged)
+    Q_PROPERTY(RecordEncoding recordEncoding READ recordEncoding WRITE setRecordEncoding NOTIFY recordEncodingChanged)
+    Q_PROPERTY(int unsavedChanges READ unsavedChanges NOTIFY unsavedChangesChanged)
+    Q_PROPERTY(int pendingWrites READ pendingWrites NOTIFY writerStatusChanged)
+    Q_PROPERTY(qint64 lastFlushLatency READ lastFlushLatency NOTIFY writerStatusChanged)
+    Q_PROPERTY(bool libraryTransferRunning READ libraryTransferRunning NOTIFY libraryTransferRunningChanged)
+    // History only: entries not opened for hotDays move to the HistoryArchive. 0 keeps
+    // them all in the hot tier.
+    Q_PROPERTY(int hotDays READ hotDays WRITE setHotDays NOTIFY hotDaysChanged)
 
 public:
     QVariant rootPathIndex() const;
@@ -110,11 +199,33 @@ public:
     ~FileSystemModel() override;
 
     inline bool ready() const { return m_ready; }
+    const MetadataTable &table() const { return m_table; }
+    // See SearchIndexes::find(). The result holds until searchGeneration() changes.
+    QList<int> findVideos(const QString &term, bool titles, bool channels, bool fuzzy = false,
+                          const QList<int> *within = nullptr) const;
+    MetadataTable::RowId tableRow(const QModelIndex &index) const; // -1 for categories
+    QObject *searchResults() { return &m_searchResults; }
+    quint64 searchGeneration() const { return m_searchGeneration; }
+    // With search, a snapshot without an index carries the records to build one on the worker
+    FilterSnapshot filterSnapshot(const QString &extWorkingDirRoot, bool search) const;
+    static bool buildSearchIndex(FilterSnapshot &s, const std::atomic_bool &cancel); // false if cancelled
+    void adoptSearchIndex(const SearchIndexes &search, quint64 tableGeneration, quint64 searchGeneration);
+    // SearchIndexes::matches() for the video of a table row, from its current texts
+    bool videoMatches(MetadataTable::RowId row, const QString &term, bool titles, bool channels,
+                      bool fuzzy) const;
     int extAppQueueTotal() const { return m_extAppTotal; }
     int extAppQueueCompleted() const { return m_extAppCompleted; }
     bool extAppQueueRunning() const { return m_extAppRunning; }
+    int unsavedChanges() const { return int(m_dirtyVideos.size() + m_dirtyChannels.size()); }
+    int pendingWrites() const { return m_writer->queueDepth(); }
+    qint64 lastFlushLatency() const { return m_writer->lastFlushLatency(); }
+    bool libraryTransferRunning() const { return m_transferRunning; }
+    int hotDays() const { return m_hotDays; }
+    void setHotDays(int days);
 
     enum Roles {
+        FileNameRole = Qt::UserRole + 1,
+        FilePathRole = Qt::UserRole + 2,
         SizeRole = Qt::UserRole + 4,
         DisplayableFilePermissionsRole = Qt::UserRole + 5,
         LastModifiedRole = Qt::UserRole + 6,
@@ -127,9 +238,31 @@ public:
         KeyRole = Qt::UserRole + 13,
         IsDirRole = Qt::UserRole + 14,
         VersionRole = Qt::UserRole + 15,
+        FilterStateRole = Qt::UserRole + 16, // the proxy's filter role: MetadataTable flags
     };
     Q_ENUM(Roles)
 
+    // FileStorage: one .yayc file per video (the historical layout).
+    // JournalStorage: all records in a single MetadataJournal at the root, detected by its presence.
+    enum StorageEngine {
+        FileStorage = 0,
+        JournalStorage
+    };
+    Q_ENUM(StorageEngine)
+
+    StorageEngine storageEngine() const;
+    void setStorageEngine(StorageEngine engine);
+
+    // Encoding of the .yayc/.yaycc files of the root, see RecordFormat
+    enum RecordEncoding {
+        JsonEncoding = RecordFormat::Json,
+        CborEncoding = RecordFormat::Cbor
+    };
+    Q_ENUM(RecordEncoding)
+
+    RecordEncoding recordEncoding() const;
+    void setRecordEncoding(RecordEncoding encoding);
+
     Q_INVOKABLE QModelIndex setRoot(QString newPath, FileSystemModel *oldModel = nullptr);
     Q_INVOKABLE QString key(const QModelIndex &item) const;
     Q_INVOKABLE QString title(const QModelIndex &item) const;
@@ -139,7 +272,30 @@ public:
     Q_INVOKABLE void bumpVersion(const QString &key);
     Q_INVOKABLE void bumpVersion(const QModelIndex &idx);
     Q_INVOKABLE QString categoryName(const QString &key) const;
+    Q_INVOKABLE int importFiles();
+    Q_INVOKABLE int exportFiles(const QString &destinationPath) const;
+    // Whole library as a single LibraryStream file, on a worker thread. The format follows
+    // the extension (*.cbor, anything else is NDJSON). Progress and completion are signaled.
+    Q_INVOKABLE bool exportLibrary(const QString &path, bool withThumbnails = false);
+    Q_INVOKABLE bool importLibrary(const QString &path);
+    Q_INVOKABLE int compactHistory();
+    // Matches title or channel, newest first. Reads the archive on first use.
+    Q_INVOKABLE QVariantList searchArchive(const QString &term, int limit = 200);
+    // Fills searchResults with the best fuzzy matches, returns how many there are
+    Q_INVOKABLE int rankedSearch(const QString &term, bool titles = true, bool channels = true, int limit = 200);
+    Q_INVOKABLE bool restoreArchived(const QString &key);
+
+    QString rootPath() const { return m_rootPath; }
+    Q_INVOKABLE QString filePath(const QModelIndex &index) const;
+    QString fileName(const QModelIndex &index) const;
+    bool isDir(const QModelIndex &index) const;
+    qint64 sortKey(const QModelIndex &index) const; // creation time of a video, 0 for categories
 
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     QHash<int, QByteArray> roleNames() const override;
 
@@ -215,8 +371,66 @@ signals:
     void versionBumped(const QString &key);
     void structureChanged();
     void categoryReloadRequested(const QString &path);
+    void directoryLoaded(const QString &path);
+    void storageEngineChanged();
+    void recordEncodingChanged();
+    void writerStatusChanged();
+    void unsavedChangesChanged();
+    void libraryTransferRunningChanged();
+    void hotDaysChanged();
+    void historyCompacted(int archived);
+    void libraryTransferProgress(qint64 done, qint64 total);
+    void libraryTransferFinished(bool success, qint64 count, const QString &error);
 
 private:
+    const VideoMetadata *entry(const QString &key) const;
+    // Writable access, keeps m_dirtyVideos / m_dirtyChannels current. The key must be cached.
+    DirtyGuard<VideoMetadata> editEntry(const QString &key) { return {m_cache[key], key, m_dirtyVideos}; }
+    DirtyGuard<ChannelMetadata> editChannel(const QString &key) { return {m_channelCache[key], key, m_dirtyChannels}; }
+    const ChannelMetadata *channel(const QString &key) const;
+    void settleWrites();
+    void relocateEntry(const QString &key, const QDir &d);
+    void requeueRecords(const QStringList &paths);
+    void adoptCache();
+    void publishThumbnails(const QHash<QString, VideoMetadata> &videos) const;
+    void applyDirectoryChanges(const QStringList &dirs);
+    void mergeImported(QHash<QString, VideoMetadata> videos, QHash<QString, ChannelMetadata> channels);
+    void finishTransfer(bool success, qint64 count, const QString &error);
+    void noteActivity(const QString &key);
+    static QSet<QString> thumbnailRefs(const QHash<QString, VideoMetadata> &videos,
+                                       const HistoryArchive *archive = nullptr);
+    void finishCompaction(const QString &rootPath, const QList<VideoMetadata> &cold, bool ok);
+    void buryArchived(const QStringList &keys);
+    void touch(const QString &key);
+    void dropVideos(const QStringList &keys);
+    void unindexVideo(const QString &key);
+    const RowRecord &rowRecord(const CategoryTree::Node *n, int video) const;
+    void invalidateRow(const QString &key);
+    void ensureSearchIndex() const;
+    bool indexRow(const QString &key) const;
+    void reindexChannel(const QString &channelKey);
+    void resetSearchIndex();
+    void rebuildTree();
+    CategoryTree::Node *categoryNode(const QModelIndex &index) const;
+    QModelIndex nodeIndex(const CategoryTree::Node *n) const;
+    QModelIndex videoIndex(const QString &key) const;
+    CategoryTree::Node *insertCategory(const QString &path);
+    void removeCategory(CategoryTree::Node *n);
+    void syncCategories(const QString &path);
+    void placeVideos(const QStringList &keys);
+    void workingDirChanged(const QString &key, const QString &extWorkingDirRoot);
+    void rowChanged(const QString &key, const QList<int> &roles = {});
+    void flushChanges();
+    static quint32 roleBits(const QList<int> &roles);
+    static QList<int> bitRoles(quint32 bits);
+    void sortVideos(CategoryTree::Node *n);
+    void sortNodes(CategoryTree::Node *n);
+    static qint64 sortKey(const VideoMetadata &m);
+    void unplaceVideo(const QString &key);
+    void unplaceVideos(const QStringList &keys);
+    void saveEntry(const QString &key);
+    void saveChannel(const QString &key);
+    void relocateCategory(const QString &oldPath, const QString &newPath);
     void addThumbnail(const QString &key, const QByteArray &thumbnailData);
     void updateChannel(const QString &key, const QString &channelId, const QString &channelName);
     void addChannel(const QString &channelId, const Platform::Vendor vendor,
@@ -0,0 +1,205 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+#include "FuzzyIndex.h"
+
+#include <QStringList>
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+// One query word, with its match masks ready for prefixDistance()
+struct Pattern {
+    QStringView text;
+    int maxDistance{0};
+    std::array<quint64, 128> ascii{};
+    QList<QPair<char16_t, quint64>> other;
+
+    explicit Pattern(QStringView t) : text(t.left(64)) {
+        maxDistance = text.size() < 4 ? 0 : (text.size() < 8 ? 1 : 2);
+        for (qsizetype i = 0; i < text.size(); ++i) {
+            const char16_t c = text.at(i).unicode();
+            const quint64 bit = quint64(1) << i;
+            if (c < 128) {
+                ascii[c] |= bit;
+                continue;
+            }
+            auto it = std::find_if(other.begin(), other.end(), [c](const auto &p) { return p.first == c; });
+            if (it == other.end())
+                other.append({c, bit});
+            else
+                it->second |= bit;
+        }
+    }
+
+    quint64 mask(char16_t c) const {
+        if (c < 128)
+            return ascii[c];
+        for (const auto &p : other) {
+            if (p.first == c)
+                return p.second;
+        }
+        return 0;
+    }
+};
+
+// Bit-parallel edit distance between the pattern and each prefix of word, keeping the
+// smallest one among the prefixes that are not more than maxDistance longer or shorter
+int distance(const Pattern &p, QStringView word) {
+    const int m = int(p.text.size());
+    const int k = p.maxDistance;
+    const quint64 high = quint64(1) << (m - 1);
+    quint64 pv = ~quint64(0);
+    quint64 mv = 0;
+    int score = m;
+    int best = (m <= k) ? m : k + 1;
+    const int n = int(qMin<qsizetype>(word.size(), m + k));
+    for (int j = 0; j < n; ++j) {
+        const quint64 eq = p.mask(word.at(j).unicode());
+        const quint64 xv = eq | mv;
+        const quint64 xh = (((eq & pv) + pv) ^ pv) | eq;
+        quint64 ph = mv | ~(xh | pv);
+        quint64 mh = pv & xh;
+        if (ph & high)
+            ++score;
+        else if (mh & high)
+            --score;
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+        if (j + 1 >= m - k && score < best)
+            best = score;
+    }
+    return best;
+}
+
+float wordScore(const Pattern &p, QStringView word) {
+    if (word.startsWith(p.text))
+        return word.size() == p.text.size() ? 1.0f : 0.8f + 0.2f * float(p.text.size()) / float(word.size());
+    if (!p.maxDistance || word.size() < p.text.size() - p.maxDistance)
+        return 0.0f;
+    const int d = distance(p, word);
+    return d > p.maxDistance ? 0.0f : 0.6f - 0.2f * float(d - 1);
+}
+
+// Best match of the pattern among the space separated words of text
+float bestScore(const Pattern &p, const QString &text) {
+    float best = 0.0f;
+    const QStringView all(text);
+    qsizetype start = 0;
+    while (start < all.size()) {
+        qsizetype end = all.indexOf(QLatin1Char(' '), start);
+        if (end < 0)
+            end = all.size();
+        best = qMax(best, wordScore(p, all.mid(start, end - start)));
+        if (best >= 1.0f)
+            break;
+        start = end + 1;
+    }
+    return best;
+}
+
+} // namespace
+
+bool FuzzyIndex::insert(int doc, const QString &title, const QString &channel) {
+    if (doc < 0)
+        return false;
+    const QString t = words(title);
+    const QString c = words(channel);
+    if (doc >= m_titles.size()) {
+        m_titles.resize(doc + 1);
+        m_channels.resize(doc + 1);
+    }
+    if (!m_titles.at(doc).isNull() && m_titles.at(doc) == t && m_channels.at(doc) == c)
+        return false;
+    m_titles[doc] = t.isNull() ? QStringLiteral("") : t; // null marks absent documents
+    m_channels[doc] = c;
+    return true;
+}
+
+void FuzzyIndex::remove(int doc) {
+    if (doc < 0 || doc >= m_titles.size())
+        return;
+    m_titles[doc] = QString();
+    m_channels[doc] = QString();
+}
+
+void FuzzyIndex::clear() {
+    m_titles.clear();
+    m_channels.clear();
+}
+
+QList<FuzzyIndex::Hit> FuzzyIndex::find(const QString &term, bool titles, bool channels,
+                                        const QList<int> *within) const {
+    QList<Hit> res;
+    const QString query = words(term);
+    const auto tokens = QStringView(query).split(QLatin1Char(' '), Qt::SkipEmptyParts);
+    if (tokens.isEmpty() || (!titles && !channels))
+        return res;
+    QList<Pattern> patterns;
+    patterns.reserve(tokens.size());
+    for (const auto &t : tokens)
+        patterns.emplace_back(t);
+
+    const qsizetype count = within ? within->size() : m_titles.size();
+    for (qsizetype i = 0; i < count; ++i) {
+        const int doc = within ? within->at(i) : int(i);
+        if (doc < 0 || doc >= m_titles.size() || m_titles.at(doc).isNull())
+            continue;
+        float total = 0.0f;
+        for (const auto &p : std::as_const(patterns)) {
+            float s = titles ? bestScore(p, m_titles.at(doc)) : 0.0f;
+            if (channels && s < 1.0f)
+                s = qMax(s, channelWeight * bestScore(p, m_channels.at(doc)));
+            if (s <= 0.0f) {
+                total = 0.0f;
+                break;
+            }
+            total += s;
+        }
+        if (total > 0.0f)
+            res.append({doc, total / float(patterns.size())});
+    }
+    return res;
+}
+
+QString FuzzyIndex::words(const QString &text) {
+    QString res;
+    res.reserve(text.size());
+    bool space = false;
+    for (const QChar c : text) {
+        if (c.isLetterOrNumber()) {
+            if (space && !res.isEmpty())
+                res.append(QLatin1Char(' '));
+            space = false;
+            res.append(c);
+        } else {
+            space = true;
+        }
+    }
+    return res.toCaseFolded();
+}
+
+int FuzzyIndex::prefixDistance(QStringView term, QStringView word, int maxDistance) {
+    if (term.isEmpty())
+        return 0;
+    Pattern p(term);
+    p.maxDistance = maxDistance;
+    return distance(p, word);
+}
@@ -0,0 +1,57 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+#ifndef FUZZYINDEX_H
+#define FUZZYINDEX_H
+
+#include <QList>
+#include <QString>
+#include <QStringView>
+
+// Typo tolerant word search over titles and channel names. Each document keeps its words
+// case folded and separated by single spaces, computed once, so a query only walks those
+// buffers. Every word of the query has to match a word of the document, either as a
+// prefix or within a small edit distance, computed bit-parallel (Myers/Hyyrö) over at most
+// length + distance characters of the word. Documents are small non negative integers, like
+// MetadataTable row ids.
+class FuzzyIndex
+{
+public:
+    struct Hit {
+        int doc;
+        float score; // 0..1, text relevance only
+    };
+
+    static constexpr float channelWeight = 0.75f; // a word found in the title counts more
+
+    bool insert(int doc, const QString &title, const QString &channel); // false if unchanged
+    void remove(int doc);
+    void clear();
+
+    // Ascending docs; with within, only those are scored
+    QList<Hit> find(const QString &term, bool titles, bool channels,
+                    const QList<int> *within = nullptr) const;
+
+    static QString words(const QString &text); // folded, one space between words
+    // Smallest edit distance between term and a prefix of word, or maxDistance + 1
+    static int prefixDistance(QStringView term, QStringView word, int maxDistance);
+
+private:
+    QList<QString> m_titles; // words(), by document; null when absent
+    QList<QString> m_channels;
+};
+
+#endif // FUZZYINDEX_H
@@ -0,0 +1,300 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#include "HistoryArchive.h"
+#include "LibraryStream.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QBuffer>
+#include <QDataStream>
+#include <QMutex>
+#include <QDebug>
+
+namespace {
+constexpr quint32 segmentMagic = 0x59415941; // "YAYA"
+constexpr quint32 segmentVersion = 3;
+
+QMutex &fileLock() {
+    static QMutex lock;
+    return lock;
+}
+
+QByteArray header(const QStringList &keys, const QStringList &refs, const QStringList &removed,
+                  const QByteArray &payload) {
+    QByteArray segment;
+    QDataStream ds(&segment, QIODevice::WriteOnly);
+    ds.setVersion(QDataStream::Qt_6_0);
+    ds << segmentMagic << segmentVersion << keys << refs << removed << payload;
+    return segment;
+}
+
+QByteArray encode(const QDir &root, const QList<VideoMetadata> &videos) {
+    QByteArray stream;
+    QBuffer out(&stream);
+    out.open(QIODevice::WriteOnly);
+    LibraryWriter w(&out, LibraryStream::Cbor, root, false);
+    w.header(videos.size(), 0);
+    QStringList keys;
+    QStringList refs;
+    keys.reserve(videos.size());
+    refs.reserve(videos.size());
+    for (const auto &v : videos) {
+        w.video(v);
+        keys.append(v.key);
+        refs.append(v.thumbnailRef);
+    }
+    out.close();
+    return header(keys, refs, {}, qCompress(stream));
+}
+
+void decode(const QByteArray &payload, const QDir &root, QHash<QString, VideoMetadata> &videos) {
+    if (payload.isEmpty()) // tombstones only
+        return;
+    QByteArray stream = qUncompress(payload);
+    QBuffer buffer(&stream);
+    buffer.open(QIODevice::ReadOnly);
+    LibraryReader reader(&buffer, root);
+    for (auto item = reader.next(); item.type != LibraryReader::Item::End; item = reader.next()) {
+        if (item.type == LibraryReader::Item::Error) {
+            qWarning() << "Corrupt history archive segment: " << reader.errorString();
+            break;
+        }
+        if (item.type == LibraryReader::Item::Video)
+            videos.insert(item.video.key, item.video);
+    }
+}
+}
+
+HistoryArchive::HistoryArchive(const QDir &root) : m_root(root) {}
+
+bool HistoryArchive::exists(const QDir &root) {
+    return root.exists(historyArchiveFileName);
+}
+
+QString HistoryArchive::filePath() const {
+    return m_root.absoluteFilePath(historyArchiveFileName);
+}
+
+void HistoryArchive::readIndex() {
+    if (m_indexed)
+        return;
+    QHash<QString, QString> index;
+    {
+        QMutexLocker locker(&fileLock());
+        readHeaders(filePath(), m_root, index);
+    }
+    index.insert(m_index); // inserted meanwhile, newer
+    m_index.swap(index);
+    m_indexed = true;
+}
+
+void HistoryArchive::load() {
+    if (m_loaded)
+        return;
+    readIndex();
+    QHash<QString, VideoMetadata> videos;
+    {
+        QMutexLocker locker(&fileLock());
+        readSegments(filePath(), m_root, videos);
+    }
+    // What was inserted or taken since is already reflected in the index
+    for (auto it = videos.cbegin(); it != videos.cend(); ++it) {
+        if (m_index.contains(it.key()) && !m_records.contains(it.key()))
+            m_records.insert(it.key(), it.value());
+    }
+    m_loaded = true;
+}
+
+QSet<QString> HistoryArchive::thumbnailRefs() const {
+    QSet<QString> res;
+    for (const auto &ref : m_index) {
+        if (!ref.isEmpty())
+            res.insert(ref);
+    }
+    return res;
+}
+
+VideoMetadata HistoryArchive::take(const QString &key) {
+    load();
+    m_index.remove(key);
+    return m_records.take(key);
+}
+
+bool HistoryArchive::remove(const QString &key) {
+    m_records.remove(key);
+    return m_index.remove(key);
+}
+
+void HistoryArchive::insert(const VideoMetadata &v) {
+    m_index.insert(v.key, v.thumbnailRef);
+    m_records.insert(v.key, v);
+}
+
+bool HistoryArchive::readSegments(const QString &path, const QDir &root,
+                                  QHash<QString, VideoMetadata> &videos) {
+    QFile f(path);
+    if (!f.exists())
+        return true;
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed opening file " << f.fileName() << " for reading.";
+        return false;
+    }
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_6_0);
+    while (!in.atEnd()) {
+        quint32 magic = 0;
+        quint32 version = 0;
+        QStringList keys;
+        QStringList refs;
+        QStringList removed;
+        QByteArray payload;
+        in >> magic >> version;
+        if (version >= 2)
+            in >> keys >> refs;
+        if (version >= 3)
+            in >> removed;
+        in >> payload;
+        if (in.status() != QDataStream::Ok || magic != segmentMagic || version > segmentVersion) {
+            // A torn last segment is the expected outcome of a crash during compaction
+            qWarning() << "Ignoring corrupt history archive segment in " << f.fileName();
+            break;
+        }
+        for (const auto &key : std::as_const(removed))
+            videos.remove(key);
+        decode(payload, root, videos);
+    }
+    return true;
+}
+
+// Key and ref lists only, payloads are skipped. Version 1 segments have to be decoded.
+void HistoryArchive::readHeaders(const QString &path, const QDir &root, QHash<QString, QString> &index) {
+    QFile f(path);
+    if (!f.exists() || !f.open(QIODevice::ReadOnly))
+        return;
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_6_0);
+    while (!in.atEnd()) {
+        quint32 magic = 0;
+        quint32 version = 0;
+        in >> magic >> version;
+        if (in.status() != QDataStream::Ok || magic != segmentMagic || version > segmentVersion)
+            break;
+        if (version < 2) {
+            QByteArray payload;
+            in >> payload;
+            if (in.status() != QDataStream::Ok)
+                break;
+            QHash<QString, VideoMetadata> videos;
+            decode(payload, root, videos);
+            for (const auto &v : std::as_const(videos))
+                index.insert(v.key, v.thumbnailRef);
+            continue;
+        }
+        QStringList keys;
+        QStringList refs;
+        QStringList removed;
+        quint32 size = 0;
+        in >> keys >> refs;
+        if (version >= 3)
+            in >> removed;
+        in >> size;
+        if (in.status() != QDataStream::Ok || keys.size() != refs.size()
+            || in.skipRawData(size) != qint64(size))
+            break; // torn
+        for (const auto &key : std::as_const(removed))
+            index.remove(key);
+        for (qsizetype i = 0; i < keys.size(); ++i)
+            index.insert(keys.at(i), refs.at(i));
+    }
+}
+
+bool HistoryArchive::appendSegment(const QString &path, const QDir &root,
+                                   const QList<VideoMetadata> &videos) {
+    if (videos.isEmpty())
+        return true;
+    return append(path, encode(root, videos));
+}
+
+// Rotation drops the removed keys along with the tombstones
+bool HistoryArchive::appendTombstones(const QString &path, const QStringList &keys) {
+    if (keys.isEmpty() || !QFile::exists(path))
+        return true;
+    return append(path, header({}, {}, keys, QByteArray(""))); // not null, which streams as size -1
+}
+
+bool HistoryArchive::append(const QString &path, const QByteArray &segment) {
+    QMutexLocker locker(&fileLock());
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed opening file " << f.fileName() << " for appending.";
+        return false;
+    }
+    if (f.write(segment) != segment.size() || !f.flush()) {
+        qWarning() << "Failed writing " << f.fileName() << " : " << f.errorString();
+        return false;
+    }
+    return true;
+}
+
+int HistoryArchive::segmentCount(const QString &path) {
+    QMutexLocker locker(&fileLock());
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return 0;
+    // Headers only, payloads are skipped
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_6_0);
+    int count = 0;
+    while (!in.atEnd()) {
+        quint32 magic = 0;
+        quint32 version = 0;
+        QStringList keys;
+        QStringList refs;
+        QStringList removed;
+        quint32 size = 0;
+        in >> magic >> version;
+        if (version >= 2)
+            in >> keys >> refs;
+        if (version >= 3)
+            in >> removed;
+        in >> size;
+        if (in.status() != QDataStream::Ok || magic != segmentMagic || in.skipRawData(size) != qint64(size))
+            break;
+        ++count;
+    }
+    return count;
+}
+
+// Merges every segment into a single one, replacing the file atomically
+bool HistoryArchive::rotate(const QString &path, const QDir &root) {
+    QMutexLocker locker(&fileLock());
+    QHash<QString, VideoMetadata> videos;
+    if (!readSegments(path, root, videos))
+        return false;
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed opening file " << f.fileName() << " for writing.";
+        return false;
+    }
+    f.write(encode(root, videos.values()));
+    if (!f.commit()) {
+        qWarning() << "Failed writing " << f.fileName() << " : " << f.errorString();
+        return false;
+    }
+    return true;
+}
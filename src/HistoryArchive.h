@@ -0,0 +1,83 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#ifndef HISTORYARCHIVE_H
+#define HISTORYARCHIVE_H
+
+#include "VideoMetadata.h"
+
+#include <QDir>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+// Cold tier of a history root, <root>/.yayc.archive.
+// The history gets a record for every video ever opened. Only the recent ones (the hot
+// tier) stay as .yayc files and are loaded at startup; the ones not opened for a while
+// are moved here by FileSystemModel::compactHistory(). The file is a sequence of segments,
+// one per compaction, each a qCompress()ed LibraryStream (CBOR) behind a small header:
+//   quint32 magic, quint32 version, QStringList keys, QStringList thumbnail refs,
+//   QStringList removed keys, QByteArray payload (QDataStream)
+// Version 1 segments have no key and ref lists, version 2 ones no removed keys.
+// Later segments win over earlier ones, and hot records over archived ones. A key restored
+// or deleted is recorded as removed by a tombstone segment, so that it does not come back
+// from an earlier one.
+// readIndex() only reads the headers, and is enough for contains() and thumbnailRefs().
+// The records themselves are read by load(), on the first search or restore. When the
+// segments pile up, rotate() merges them into one.
+class HistoryArchive
+{
+public:
+    static constexpr int maxSegments = 8;
+
+    explicit HistoryArchive(const QDir &root);
+
+    static bool exists(const QDir &root);
+    QString filePath() const;
+
+    void readIndex();
+    bool isLoaded() const { return m_loaded; }
+    void load();
+    const QHash<QString, VideoMetadata> &records() const { return m_records; }
+    bool contains(const QString &key) const { return m_index.contains(key); }
+    QSet<QString> thumbnailRefs() const;
+    VideoMetadata take(const QString &key); // requires load()
+    bool remove(const QString &key); // false if not archived
+    void insert(const VideoMetadata &v); // mirrors an appended segment
+
+    // File level operations, safe to run on a worker thread. They are serialized with
+    // each other, a reader never sees a segment that is still being appended.
+    static bool appendSegment(const QString &path, const QDir &root, const QList<VideoMetadata> &videos);
+    static bool appendTombstones(const QString &path, const QStringList &keys);
+    static int segmentCount(const QString &path);
+    static bool rotate(const QString &path, const QDir &root);
+
+private:
+    static bool append(const QString &path, const QByteArray &segment);
+    static bool readSegments(const QString &path, const QDir &root,
+                             QHash<QString, VideoMetadata> &videos);
+    static void readHeaders(const QString &path, const QDir &root, QHash<QString, QString> &index);
+
+    QDir m_root;
+    bool m_indexed{false};
+    bool m_loaded{false};
+    QHash<QString, QString> m_index; // key -> thumbnail ref, of every archived record
+    QHash<QString, VideoMetadata> m_records;
+};
+
+#endif // HISTORYARCHIVE_H
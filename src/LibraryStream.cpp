@@ -0,0 +1,237 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#include "LibraryStream.h"
+
+#include <QIODevice>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QCborStreamWriter>
+#include <QCborStreamReader>
+#include <QDebug>
+
+namespace {
+enum Op : quint64 {
+    HeaderOp = 0,
+    CategoryOp,
+    VideoOp,
+    ChannelOp
+};
+}
+
+LibraryStream::Format LibraryStream::formatForPath(const QString &path) {
+    return path.endsWith(QLatin1String(".cbor"), Qt::CaseInsensitive) ? Cbor : Ndjson;
+}
+
+LibraryWriter::LibraryWriter(QIODevice *out, LibraryStream::Format format, const QDir &root,
+                             bool withThumbnails)
+    : m_out(out), m_format(format), m_root(root), m_withThumbnails(withThumbnails) {
+    if (m_format == LibraryStream::Cbor) {
+        m_cbor.reset(new QCborStreamWriter(m_out));
+        m_cbor->append(QCborKnownTags::Signature);
+    }
+}
+
+LibraryWriter::~LibraryWriter() {}
+
+QString LibraryWriter::relative(const QString &dirPath) const {
+    QString rel = m_root.relativeFilePath(dirPath);
+    if (rel == QLatin1String("."))
+        rel.clear();
+    return rel;
+}
+
+void LibraryWriter::writeLine(const QVariantMap &m) {
+    m_out->write(QJsonDocument::fromVariant(m).toJson(QJsonDocument::Compact));
+    m_out->write("\n", 1);
+}
+
+void LibraryWriter::header(qint64 videos, qint64 channels) {
+    if (m_cbor) {
+        m_cbor->startArray(4);
+        m_cbor->append(quint64(HeaderOp));
+        m_cbor->append(LibraryStream::version);
+        m_cbor->append(videos);
+        m_cbor->append(channels);
+        m_cbor->endArray();
+        return;
+    }
+    writeLine({{"op", QStringLiteral("library")},
+               {"version", LibraryStream::version},
+               {"videos", videos},
+               {"channels", channels}});
+}
+
+void LibraryWriter::category(const QString &dirPath) {
+    if (m_cbor) {
+        m_cbor->startArray(2);
+        m_cbor->append(quint64(CategoryOp));
+        m_cbor->append(relative(dirPath));
+        m_cbor->endArray();
+        return;
+    }
+    writeLine({{"op", QStringLiteral("category")}, {"category", relative(dirPath)}});
+}
+
+void LibraryWriter::video(const VideoMetadata &v) {
+    if (m_cbor) {
+        m_cbor->startArray(4);
+        m_cbor->append(quint64(VideoOp));
+        m_cbor->append(v.key);
+        m_cbor->append(relative(v.parentPath()));
+        m_cbor->append(v.toCbor(m_withThumbnails));
+        m_cbor->endArray();
+        return;
+    }
+    QVariantMap m = v.toVariantMap(m_withThumbnails);
+    m["op"] = QStringLiteral("video");
+    m["key"] = v.key;
+    m["category"] = relative(v.parentPath());
+    writeLine(m);
+}
+
+void LibraryWriter::channel(const ChannelMetadata &c) {
+    if (m_cbor) {
+        m_cbor->startArray(3);
+        m_cbor->append(quint64(ChannelOp));
+        m_cbor->append(c.key());
+        m_cbor->append(c.toCbor());
+        m_cbor->endArray();
+        return;
+    }
+    QVariantMap m = c.toVariantMap();
+    m["op"] = QStringLiteral("channel");
+    m["key"] = c.key();
+    writeLine(m);
+}
+
+LibraryReader::LibraryReader(QIODevice *in, const QDir &root)
+    : m_in(in), m_root(root), m_channelsDir(root.absoluteFilePath(".channels")) {
+    m_format = RecordFormat::isCbor(m_in->peek(3)) ? LibraryStream::Cbor : LibraryStream::Ndjson;
+    if (m_format == LibraryStream::Cbor) {
+        m_cbor.reset(new QCborStreamReader(m_in));
+        if (m_cbor->isTag() && m_cbor->toTag() == QCborTag(QCborKnownTags::Signature))
+            m_cbor->next();
+    }
+}
+
+LibraryReader::~LibraryReader() {}
+
+LibraryReader::Item LibraryReader::next() {
+    return m_cbor ? nextCbor() : nextLine();
+}
+
+LibraryReader::Item LibraryReader::fail(const QString &error) {
+    m_error = error;
+    Item res;
+    res.type = Item::Error;
+    return res;
+}
+
+void LibraryReader::finishVideo(Item &item, const QString &key, const QString &category) {
+    item.type = Item::Video;
+    item.category = m_root.absoluteFilePath(category);
+    item.video.key = key;
+    item.video.vendor = Platform::toVendor(videoVendor(key));
+    item.video.setParent(QDir(item.category));
+    if (!item.video.creationDate.isValid())
+        item.video.creationDate = QDateTime::currentDateTimeUtc();
+}
+
+LibraryReader::Item LibraryReader::nextLine() {
+    forever {
+        if (m_in->atEnd())
+            return Item();
+        const QByteArray line = m_in->readLine().trimmed();
+        if (line.isEmpty())
+            continue;
+        QJsonParseError error;
+        const QJsonObject o = QJsonDocument::fromJson(line, &error).object();
+        if (error.error != QJsonParseError::NoError)
+            return fail(QStringLiteral("Corrupt line: ") + error.errorString());
+
+        Item item;
+        const QString op = o.value(QLatin1String("op")).toString();
+        if (op == QLatin1String("video")) {
+            item.video.fromVariantMap(o.toVariantMap());
+            finishVideo(item, o.value(QLatin1String("key")).toString(),
+                        o.value(QLatin1String("category")).toString());
+        } else if (op == QLatin1String("channel")) {
+            item.type = Item::Channel;
+            item.channel = ChannelMetadata(o.value(QLatin1String("key")).toString(), m_channelsDir);
+            item.channel.fromVariantMap(o.toVariantMap());
+        } else if (op == QLatin1String("category")) {
+            item.type = Item::Category;
+            item.category = m_root.absoluteFilePath(o.value(QLatin1String("category")).toString());
+        } else if (op == QLatin1String("library")) {
+            if (o.value(QLatin1String("version")).toInteger() > qint64(LibraryStream::version))
+                return fail(QStringLiteral("Unsupported library version"));
+            item.type = Item::Header;
+            item.videos = o.value(QLatin1String("videos")).toInteger();
+            item.channels = o.value(QLatin1String("channels")).toInteger();
+        } else {
+            continue; // written by a newer version
+        }
+        return item;
+    }
+}
+
+LibraryReader::Item LibraryReader::nextCbor() {
+    QCborStreamReader &r = *m_cbor;
+    if (r.lastError() == QCborError::EndOfFile || (!r.isValid() && m_in->atEnd()))
+        return Item();
+    if (!r.isArray() || !r.enterContainer())
+        return fail(QStringLiteral("Corrupt stream: ") + r.lastError().toString());
+
+    Item item;
+    switch (RecordFormat::readInteger(r)) {
+    case HeaderOp:
+        if (quint64(RecordFormat::readInteger(r)) > LibraryStream::version)
+            return fail(QStringLiteral("Unsupported library version"));
+        item.type = Item::Header;
+        item.videos = RecordFormat::readInteger(r);
+        item.channels = RecordFormat::readInteger(r);
+        break;
+    case CategoryOp:
+        item.type = Item::Category;
+        item.category = m_root.absoluteFilePath(RecordFormat::readString(r));
+        break;
+    case VideoOp: {
+        const QString key = RecordFormat::readString(r);
+        const QString category = RecordFormat::readString(r);
+        if (!item.video.fromCbor(RecordFormat::readBytes(r)))
+            return fail(QStringLiteral("Corrupt record for ") + key);
+        finishVideo(item, key, category);
+        break;
+    }
+    case ChannelOp: {
+        item.type = Item::Channel;
+        item.channel = ChannelMetadata(RecordFormat::readString(r), m_channelsDir);
+        if (!item.channel.fromCbor(RecordFormat::readBytes(r)))
+            return fail(QStringLiteral("Corrupt channel record"));
+        break;
+    }
+    default:
+        item.type = Item::End; // unknown op, written by a newer version: skipped below
+        break;
+    }
+    while (r.hasNext() && r.lastError() == QCborError::NoError)
+        r.next();
+    if (r.lastError() != QCborError::NoError || !r.leaveContainer())
+        return fail(QStringLiteral("Corrupt stream: ") + r.lastError().toString());
+    return (item.type == Item::End) ? nextCbor() : item;
+}
@@ -0,0 +1,114 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#ifndef LIBRARYSTREAM_H
+#define LIBRARYSTREAM_H
+
+#include "VideoMetadata.h"
+#include "ChannelMetadata.h"
+
+#include <QDir>
+#include <QString>
+#include <QScopedPointer>
+
+class QIODevice;
+class QCborStreamWriter;
+class QCborStreamReader;
+
+// A whole library as one sequential stream, for backups and moving between machines.
+// Ndjson: one JSON object per line, records shaped like MetadataJournal lines
+//   {"op":"library","version":1,"videos":N,"channels":M}
+//   {"op":"category","category":"rel/path"}
+//   {"op":"video","key":...,"category":"rel/path",...VideoMetadata fields}
+//   {"op":"channel","key":...,...ChannelMetadata fields}
+// Cbor: the self-describe tag, then a sequence of arrays
+//   [0, version, videos, channels]  [1, category]
+//   [2, key, category, record]      [3, key, record]
+// where record is the RecordFormat::Cbor encoding of the entry.
+// Categories are relative to the root. Both sides hold one item at a time.
+class LibraryStream
+{
+public:
+    enum Format {
+        Ndjson = 0,
+        Cbor
+    };
+    static constexpr quint64 version = 1;
+
+    static Format formatForPath(const QString &path); // *.cbor is Cbor
+};
+
+class LibraryWriter
+{
+public:
+    // Thumbnails are read from the ThumbnailStore and embedded when withThumbnails is set,
+    // otherwise only their references are written
+    LibraryWriter(QIODevice *out, LibraryStream::Format format, const QDir &root,
+                  bool withThumbnails);
+    ~LibraryWriter();
+
+    void header(qint64 videos, qint64 channels);
+    void category(const QString &dirPath);
+    void video(const VideoMetadata &v);
+    void channel(const ChannelMetadata &c);
+
+private:
+    QString relative(const QString &dirPath) const;
+    void writeLine(const QVariantMap &m);
+
+    QIODevice *m_out;
+    LibraryStream::Format m_format;
+    QDir m_root;
+    bool m_withThumbnails;
+    QScopedPointer<QCborStreamWriter> m_cbor;
+};
+
+class LibraryReader
+{
+public:
+    struct Item {
+        enum Type { End, Header, Category, Video, Channel, Error };
+        Type type{End};
+        QString category; // absolute, for Category and Video
+        VideoMetadata video;
+        ChannelMetadata channel;
+        qint64 videos{0}; // Header
+        qint64 channels{0};
+    };
+
+    // Records come out placed under root, the format is detected from the first bytes
+    LibraryReader(QIODevice *in, const QDir &root);
+    ~LibraryReader();
+
+    Item next();
+    QString errorString() const { return m_error; }
+
+private:
+    Item nextLine();
+    Item nextCbor();
+    Item fail(const QString &error);
+    void finishVideo(Item &item, const QString &key, const QString &category);
+
+    QIODevice *m_in;
+    QDir m_root;
+    QDir m_channelsDir;
+    LibraryStream::Format m_format;
+    QScopedPointer<QCborStreamReader> m_cbor;
+    QString m_error;
+};
+
+#endif // LIBRARYSTREAM_H
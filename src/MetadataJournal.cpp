@@ -0,0 +1,198 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#include "MetadataJournal.h"
+#include "Platform.h"
+#include "MetadataWriter.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QDebug>
+
+namespace {
+QString categoryOf(const QDir &root, const QString &parentPath) {
+    QString rel = root.relativeFilePath(parentPath);
+    if (rel == QLatin1String("."))
+        rel.clear();
+    return rel;
+}
+} // namespace
+
+MetadataJournal::MetadataJournal(const QDir &root) : m_root(root) {}
+
+void MetadataJournal::setWriter(MetadataWriter *writer) {
+    m_writer = writer;
+}
+
+bool MetadataJournal::exists(const QDir &root) {
+    return root.exists(journalFileName);
+}
+
+QString MetadataJournal::filePath() const {
+    return m_root.absoluteFilePath(journalFileName);
+}
+
+void MetadataJournal::load(QHash<QString, VideoMetadata> &videos,
+                           QHash<QString, ChannelMetadata> &channels) {
+    m_records = 0;
+    QFile f(filePath());
+    if (!f.exists())
+        return;
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed opening file " << f.fileName() << " for reading.";
+        return;
+    }
+    const QByteArray data = f.readAll();
+    f.close();
+
+    QDir channelsRoot(m_root);
+    channelsRoot.cd(".channels");
+
+    qsizetype start = 0;
+    while (start < data.size()) {
+        qsizetype end = data.indexOf('\n', start);
+        if (end < 0) // trailing line without newline: interrupted append, drop it
+            break;
+        const QByteArray line = data.sliced(start, end - start);
+        start = end + 1;
+        if (line.isEmpty())
+            continue;
+
+        QJsonParseError error;
+        const QJsonDocument d = QJsonDocument::fromJson(line, &error);
+        if (error.error != QJsonParseError::NoError || !d.isObject()) {
+            qWarning() << "Skipping corrupt journal record in " << f.fileName()
+                       << " : " << error.errorString();
+            continue;
+        }
+        ++m_records;
+        const QVariantMap m = d.object().toVariantMap();
+        const QString op = m.value("op").toString();
+        const QString key = m.value("key").toString();
+        if (key.isEmpty())
+            continue;
+
+        if (op == QLatin1String("video")) {
+            const QString category = m.value("category").toString();
+            const QString parent = category.isEmpty() ? m_root.absolutePath() : m_root.filePath(category);
+            VideoMetadata v(key, CategoryTable::intern(parent));
+            v.fromVariantMap(m);
+            if (!v.creationDate.isValid())
+                v.creationDate = QDateTime::currentDateTimeUtc();
+            v.journaled = true;
+            videos.insert(key, v);
+        } else if (op == QLatin1String("channel")) {
+            ChannelMetadata c(key, channelsRoot);
+            c.fromVariantMap(m);
+            c.journaled = true;
+            channels.insert(key, c);
+        } else if (op == QLatin1String("erase")) {
+            videos.remove(key);
+            channels.remove(key);
+        }
+    }
+}
+
+QByteArray MetadataJournal::record(const VideoMetadata &m) const {
+    QVariantMap r = m.toVariantMap();
+    r["op"] = QStringLiteral("video");
+    r["key"] = m.key;
+    r["category"] = categoryOf(m_root, m.parentPath());
+    return QJsonDocument::fromVariant(r).toJson(QJsonDocument::Compact) + '\n';
+}
+
+QByteArray MetadataJournal::record(const ChannelMetadata &c) const {
+    QVariantMap r = c.toVariantMap();
+    r["op"] = QStringLiteral("channel");
+    r["key"] = c.key();
+    return QJsonDocument::fromVariant(r).toJson(QJsonDocument::Compact) + '\n';
+}
+
+void MetadataJournal::write(const QByteArray &lines) {
+    if (m_writer) {
+        m_writer->append(filePath(), lines);
+        return;
+    }
+    QFile f(filePath());
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed opening file " << f.fileName() << " for appending.";
+        return;
+    }
+    f.write(lines);
+    f.close();
+}
+
+void MetadataJournal::append(const VideoMetadata &m) {
+    write(record(m));
+    ++m_records;
+}
+
+void MetadataJournal::append(const ChannelMetadata &c) {
+    write(record(c));
+    ++m_records;
+}
+
+void MetadataJournal::erase(const QString &key) {
+    QVariantMap r;
+    r["op"] = QStringLiteral("erase");
+    r["key"] = key;
+    write(QJsonDocument::fromVariant(r).toJson(QJsonDocument::Compact) + '\n');
+    ++m_records;
+}
+
+// Compact once superseded records outnumber live ones, but don't bother for small logs
+bool MetadataJournal::needsCompaction(qsizetype liveRecords) const {
+    return m_records > 1024 && m_records > 2 * liveRecords;
+}
+
+bool MetadataJournal::compact(const QHash<QString, VideoMetadata> &videos,
+                              const QHash<QString, ChannelMetadata> &channels) {
+    if (m_writer) {
+        QByteArray content;
+        for (const auto &c : channels)
+            content.append(record(c));
+        for (const auto &v : videos)
+            content.append(record(v));
+        m_writer->replace(filePath(), content);
+        m_records = videos.size() + channels.size();
+        return true;
+    }
+
+    QSaveFile f(filePath());
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed opening file " << f.fileName() << " for compaction.";
+        return false;
+    }
+    for (const auto &c : channels)
+        f.write(record(c));
+    for (const auto &v : videos)
+        f.write(record(v));
+    if (!f.commit()) {
+        qWarning() << "Failed compacting " << f.fileName() << " : " << f.errorString();
+        return false;
+    }
+    m_records = videos.size() + channels.size();
+    return true;
+}
+
+bool MetadataJournal::remove() {
+    m_records = 0;
+    return QFile::remove(filePath());
+}
@@ -0,0 +1,69 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#ifndef METADATAJOURNAL_H
+#define METADATAJOURNAL_H
+
+#include "VideoMetadata.h"
+#include "ChannelMetadata.h"
+
+class MetadataWriter;
+
+#include <QDir>
+#include <QHash>
+#include <QString>
+#include <QByteArray>
+
+// Single append-only log holding every record of a root.
+// One compact JSON object per line, the last line for a key wins:
+//   {"op":"video","key":...,"category":"rel/path",...VideoMetadata fields}
+//   {"op":"channel","key":...,...ChannelMetadata fields}
+//   {"op":"erase","key":...}
+// Categories remain directories. Journaled videos have no .yayc file, the model lists
+// them from the cache.
+class MetadataJournal
+{
+public:
+    explicit MetadataJournal(const QDir &root);
+
+    // Appends and compactions are queued on the writer when set, instead of done in place
+    void setWriter(MetadataWriter *writer);
+
+    static bool exists(const QDir &root);
+    QString filePath() const;
+
+    void load(QHash<QString, VideoMetadata> &videos,
+              QHash<QString, ChannelMetadata> &channels);
+    void append(const VideoMetadata &m);
+    void append(const ChannelMetadata &c);
+    void erase(const QString &key);
+    bool needsCompaction(qsizetype liveRecords) const;
+    bool compact(const QHash<QString, VideoMetadata> &videos,
+                 const QHash<QString, ChannelMetadata> &channels);
+    bool remove();
+
+private:
+    QByteArray record(const VideoMetadata &m) const;
+    QByteArray record(const ChannelMetadata &c) const;
+    void write(const QByteArray &lines);
+
+    QDir m_root;
+    MetadataWriter *m_writer{nullptr};
+    qsizetype m_records{0}; // lines currently in the file
+};
+
+#endif // METADATAJOURNAL_H
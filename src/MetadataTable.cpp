@@ -0,0 +1,106 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#include "MetadataTable.h"
+#include "Platform.h"
+
+MetadataTable::RowId MetadataTable::upsert(const VideoMetadata &m) {
+    const VideoKey k = VideoKey::fromKey(m.key);
+    RowId r = row(k);
+    if (r < 0) {
+        if (!m_freeRows.isEmpty()) {
+            r = m_freeRows.takeLast();
+            m_keys[r] = m.key;
+        } else {
+            r = RowId(m_keys.size());
+            m_keys.append(m.key);
+            m_flags.append(0);
+            m_duration.append(0.f);
+            m_position.append(0.f);
+            m_channel.append(0);
+            m_changed.append(0);
+        }
+        m_rows.insert(k, r);
+    }
+
+    quint8 f = Live;
+    if (m.starred)
+        f |= Starred;
+    if (m.viewed)
+        f |= Viewed;
+    if (k.isShorts())
+        f |= Short;
+    if (m.duration > 0.)
+        f |= Opened;
+    m_flags[r] = f;
+    m_duration[r] = float(m.duration);
+    m_position[r] = float(m.position);
+    m_channel[r] = internChannel(m.channelID);
+    m_changed[r] = ++m_generation;
+    return r;
+}
+
+void MetadataTable::remove(const QString &key) {
+    auto it = m_rows.find(VideoKey::fromKey(key, VideoKey::Lookup));
+    if (it == m_rows.end())
+        return;
+    const RowId r = it.value();
+    m_rows.erase(it);
+    m_keys[r].clear();
+    m_flags[r] = 0;
+    m_channel[r] = 0;
+    m_freeRows.append(r);
+    m_changed[r] = ++m_generation;
+}
+
+void MetadataTable::stamp(RowId r) {
+    if (r >= 0 && r < m_changed.size())
+        m_changed[r] = ++m_generation;
+}
+
+void MetadataTable::rebuild(const QHash<QString, VideoMetadata> &records) {
+    m_rows.clear();
+    m_freeRows.clear();
+    m_keys.clear();
+    m_flags.clear();
+    m_duration.clear();
+    m_position.clear();
+    m_channel.clear();
+    m_changed.clear();
+    m_rows.reserve(records.size());
+    m_keys.reserve(records.size());
+    m_flags.reserve(records.size());
+    m_duration.reserve(records.size());
+    m_position.reserve(records.size());
+    m_channel.reserve(records.size());
+    m_changed.reserve(records.size());
+    for (const auto &m : records)
+        upsert(m);
+    ++m_generation;
+}
+
+int MetadataTable::internChannel(const QString &channelId) {
+    if (channelId.isEmpty())
+        return 0;
+    auto it = m_channelIndex.constFind(channelId);
+    if (it != m_channelIndex.constEnd())
+        return it.value();
+    const int id = int(m_channelIds.size());
+    m_channelIds.append(channelId);
+    m_channelIndex.insert(channelId, id);
+    return id;
+}
@@ -0,0 +1,84 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#ifndef METADATATABLE_H
+#define METADATATABLE_H
+
+#include "VideoMetadata.h"
+#include "VideoKey.h"
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+
+// Columnar mirror of the video records, for the scans done when filtering.
+// Every key gets an integer row id; rows of erased keys are recycled. The columns are plain
+// contiguous arrays: one flag byte, float duration and position, and an interned channel id.
+// The QHash of VideoMetadata remains the storage of record, this is only an index over it
+// and the model keeps it up to date after each change.
+class MetadataTable
+{
+public:
+    using RowId = int;
+
+    enum Flag : quint8 {
+        Live    = 0x01, // row in use
+        Starred = 0x02,
+        Viewed  = 0x04,
+        Short   = 0x08,
+        Opened  = 0x10, // has a known duration
+    };
+    static constexpr int FilterFlagsCount = 0x20; // number of distinct flag combinations
+
+    RowId row(VideoKey key) const { return m_rows.value(key, -1); }
+    RowId row(QStringView key) const { return row(VideoKey::fromKey(key, VideoKey::Lookup)); }
+    RowId upsert(const VideoMetadata &m);
+    void remove(const QString &key);
+    void rebuild(const QHash<QString, VideoMetadata> &records);
+
+    qsizetype rowCount() const { return m_keys.size(); }
+    const QString &key(RowId r) const { return m_keys.at(r); }
+    quint8 flags(RowId r) const { return m_flags.at(r); }
+    float duration(RowId r) const { return m_duration.at(r); }
+    float position(RowId r) const { return m_position.at(r); }
+    int channel(RowId r) const { return m_channel.at(r); }
+    const QString &channelId(int channel) const { return m_channelIds.at(channel); }
+
+    // Bumped on every change, so that derived data can tell when it is stale
+    quint64 generation() const { return m_generation; }
+    // Generation of the last change to row r, so that a copy can tell which of its rows are stale
+    quint64 changedAt(RowId r) const { return m_changed.at(r); }
+    void stamp(RowId r); // r changed outside the columns (search texts, working dir)
+
+private:
+    int internChannel(const QString &channelId);
+
+    QHash<VideoKey, RowId> m_rows;
+    QList<RowId> m_freeRows;
+    QList<QString> m_keys;
+    QList<quint8> m_flags;
+    QList<float> m_duration;
+    QList<float> m_position;
+    QList<int> m_channel;
+    QList<quint64> m_changed;
+    QStringList m_channelIds{QString()}; // id 0: no channel
+    QHash<QString, int> m_channelIndex;
+    quint64 m_generation{0};
+};
+
+#endif // METADATATABLE_H
@@ -0,0 +1,198 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#include "MetadataWriter.h"
+
+#include <QThread>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QDebug>
+
+MetadataWriter::MetadataWriter(QObject *parent) : QObject(parent) {
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->setObjectName(QStringLiteral("MetadataWriter"));
+    m_thread->start(QThread::LowPriority);
+}
+
+MetadataWriter::~MetadataWriter() {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        m_wake.wakeOne();
+    }
+    m_thread->wait();
+    delete m_thread;
+}
+
+void MetadataWriter::replace(const QString &path, const QByteArray &data) {
+    enqueue(Job::Replace, path, data);
+}
+
+void MetadataWriter::append(const QString &path, const QByteArray &data) {
+    enqueue(Job::Append, path, data);
+}
+
+void MetadataWriter::enqueue(Job::Op op, const QString &path, const QByteArray &data) {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_pending.constFind(path);
+    if (it != m_pending.constEnd()) {
+        Job &pending = m_queue[it.value()];
+        if (op == Job::Append) { // appending to a pending replace or append just extends its content
+            pending.data.append(data);
+            return;
+        }
+        if (it.value() == m_queue.size() - 1) {
+            pending.op = Job::Replace;
+            pending.data = data;
+            return;
+        }
+        // A replace is ordered after every job queued before it, e.g. a PositionLog
+        // checkpoint after the records it folds in, so it moves to the back
+        pending.op = Job::Cancelled;
+        pending.data.clear();
+    }
+    if (m_queue.isEmpty())
+        m_oldest.start();
+    m_pending.insert(path, m_queue.size());
+    m_queue.append({op, path, data});
+    m_wake.wakeOne();
+}
+
+void MetadataWriter::waitForDone() {
+    QMutexLocker locker(&m_mutex);
+    while (!m_queue.isEmpty() || !m_batch.isEmpty())
+        m_idle.wait(&m_mutex);
+}
+
+bool MetadataWriter::isPending(const QString &path) const {
+    QMutexLocker locker(&m_mutex);
+    if (m_pending.contains(path) || m_writing == path)
+        return true;
+    for (qsizetype i = m_next; i < m_batch.size(); ++i) {
+        if (m_batch.at(i).path == path && m_batch.at(i).op != Job::Cancelled)
+            return true;
+    }
+    return false;
+}
+
+bool MetadataWriter::cancel(const QString &path) {
+    return !cancelMatching([&path](const QString &p) { return p == path; }).isEmpty();
+}
+
+QStringList MetadataWriter::cancelUnder(const QString &dir) {
+    const QString prefix = QDir::cleanPath(dir) + QLatin1Char('/');
+    return cancelMatching([&prefix](const QString &p) { return p.startsWith(prefix); });
+}
+
+// Drops the matching jobs that are not written yet, then waits if one is being written
+template <typename Match>
+QStringList MetadataWriter::cancelMatching(Match match) {
+    QMutexLocker locker(&m_mutex);
+    QStringList dropped;
+    auto drop = [&dropped](Job &job) {
+        if (job.op == Job::Cancelled)
+            return;
+        job.op = Job::Cancelled;
+        job.data.clear();
+        dropped.append(job.path);
+    };
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        if (match(it.key())) {
+            drop(m_queue[it.value()]);
+            it = m_pending.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (qsizetype i = m_next; i < m_batch.size(); ++i) {
+        if (match(m_batch.at(i).path))
+            drop(m_batch[i]);
+    }
+    while (!m_writing.isEmpty() && match(m_writing))
+        m_idle.wait(&m_mutex);
+    dropped.removeDuplicates();
+    return dropped;
+}
+
+int MetadataWriter::queueDepth() const {
+    QMutexLocker locker(&m_mutex);
+    return int(m_queue.size() + m_batch.size() - m_next + !m_writing.isEmpty());
+}
+
+qint64 MetadataWriter::lastFlushLatency() const {
+    return m_latency;
+}
+
+void MetadataWriter::run() {
+    QMutexLocker locker(&m_mutex);
+    forever {
+        while (m_queue.isEmpty() && !m_quit)
+            m_wake.wait(&m_mutex);
+        if (m_queue.isEmpty())
+            return; // quitting, and everything is on disk
+
+        m_batch.swap(m_queue);
+        m_pending.clear();
+        m_next = 0;
+        const QElapsedTimer oldest = m_oldest;
+        while (m_next < m_batch.size()) {
+            Job job = std::move(m_batch[m_next++]);
+            if (job.op == Job::Cancelled)
+                continue;
+            m_writing = job.path;
+            locker.unlock();
+            write(job);
+            locker.relock();
+            m_writing.clear();
+            m_idle.wakeAll(); // cancel() may wait for this very path
+        }
+        m_batch.clear();
+        m_next = 0;
+        m_latency = oldest.elapsed();
+
+        locker.unlock();
+        emit statusChanged();
+        locker.relock();
+        if (m_queue.isEmpty())
+            m_idle.wakeAll();
+    }
+}
+
+void MetadataWriter::write(const Job &job) {
+    if (job.op == Job::Cancelled)
+        return;
+    if (job.op == Job::Append) {
+        QFile f(job.path);
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            qWarning() << "Failed opening file " << f.fileName() << " for appending.";
+            return;
+        }
+        f.write(job.data);
+        f.close();
+        return;
+    }
+
+    QSaveFile f(job.path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed opening file " << f.fileName() << " for writing.";
+        return;
+    }
+    f.write(job.data);
+    if (!f.commit())
+        qWarning() << "Failed writing " << f.fileName() << " : " << f.errorString();
+}
@@ -0,0 +1,92 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#ifndef METADATAWRITER_H
+#define METADATAWRITER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QStringList>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <atomic>
+
+class QThread;
+
+// Write-behind queue drained by one dedicated thread.
+// Callers hand over fully serialized bytes, so the worker never touches the model.
+// Whole-file writes go through QSaveFile (write to a temporary, then rename), so a crash
+// leaves either the old or the new content, never a truncated file.
+// A job for a path that still has a pending job is merged into it: repeated replaces
+// keep only the newest content, and appends are concatenated. Jobs are written in
+// queue order, a merged replace moving to the back so it lands after everything queued before it.
+// cancel() drops the jobs of one path, for a caller that is about to move or remove the
+// file: it only waits for that path, never for the rest of the queue.
+class MetadataWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MetadataWriter(QObject *parent = nullptr);
+    ~MetadataWriter() override; // drains the queue
+
+    void replace(const QString &path, const QByteArray &data);
+    void append(const QString &path, const QByteArray &data);
+    void waitForDone();
+    bool isPending(const QString &path) const; // queued or being written
+    bool cancel(const QString &path); // true if a job was dropped
+    QStringList cancelUnder(const QString &dir); // paths of the dropped jobs
+
+    int queueDepth() const;
+    qint64 lastFlushLatency() const; // ms from the oldest job being queued to it hitting disk
+
+signals:
+    void statusChanged(); // emitted from the writer thread after every batch
+
+private:
+    struct Job {
+        enum Op { Replace, Append, Cancelled };
+        Op op;
+        QString path;
+        QByteArray data;
+    };
+
+    void enqueue(Job::Op op, const QString &path, const QByteArray &data);
+    template <typename Match>
+    QStringList cancelMatching(Match match);
+    void run();
+    static void write(const Job &job);
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_wake;
+    QWaitCondition m_idle;
+    QList<Job> m_queue;
+    QHash<QString, qsizetype> m_pending; // path -> index of its job in m_queue
+    QElapsedTimer m_oldest; // started when m_queue becomes non-empty
+    QList<Job> m_batch; // taken off m_queue by the writer thread, written one job at a time
+    qsizetype m_next{0}; // first job of m_batch not written yet
+    QString m_writing; // path of the job being written, outside of the lock
+    bool m_quit{false};
+    std::atomic<qint64> m_latency{0};
+    QThread *m_thread{nullptr};
+};
+
+#endif // METADATAWRITER_H
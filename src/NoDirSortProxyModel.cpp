@@ -20,15 +20,76 @@ In addition to the above,
 #include "YaycUtilities.h"
 #include "Platform.h"
 
-#include <QFileInfo>
+#include <QCoreApplication>
+#include <QPointer>
+#include <QThreadPool>
+
+namespace {
+
+// What a filter pass needs besides the snapshot, copied so the worker shares nothing
+struct FilterParams {
+    std::array<bool, MetadataTable::FilterFlagsCount> acceptedFlags;
+    bool workingDirFilter{false};
+    bool searchInSaved{true};
+    bool searchInUnsaved{true};
+    QString term;
+    bool titles{true};
+    bool channels{true};
+    bool fuzzy{false};
+    QList<int> rows; // matches of an earlier term
+    bool reuse{false}; // rows are the matches of term already
+    bool narrow{false}; // term extends the earlier one, its matches are among rows
+};
+
+// Runs on the worker. Returns an empty array when cancelled.
+QBitArray evaluate(const FilterSnapshot &s, FilterParams &p, const std::atomic_bool &cancel) {
+    const MetadataTable &table = s.table;
+    const bool searching = !p.term.isEmpty();
+    if (searching && !p.reuse) {
+        const QList<int> earlier = p.rows;
+        p.rows = s.search.find(p.term, p.titles, p.channels, p.fuzzy, p.narrow ? &earlier : nullptr);
+    }
+    QBitArray matches;
+    if (searching) {
+        matches = QBitArray(table.rowCount());
+        for (int r : std::as_const(p.rows)) {
+            if (r < matches.size())
+                matches.setBit(r);
+        }
+    }
+    QBitArray accepted(table.rowCount());
+    for (MetadataTable::RowId r = 0; r < table.rowCount(); ++r) {
+        if (!(r & 0xfff) && cancel)
+            return QBitArray();
+        const quint8 flags = table.flags(r);
+        if (!(flags & MetadataTable::Live) || !p.acceptedFlags[flags])
+            continue;
+        if (p.workingDirFilter) {
+            const bool hasWorkingDir = s.workingDirs.value(table.key(r)) & WorkingDirIndex::Exists;
+            if ((!hasWorkingDir && !p.searchInUnsaved) || (hasWorkingDir && !p.searchInSaved))
+                continue;
+        }
+        if (searching && !matches.testBit(r))
+            continue;
+        accepted.setBit(r);
+    }
+    return accepted;
+}
+
+} // namespace
 
 NoDirSortProxyModel::NoDirSortProxyModel() : QSortFilterProxyModel() {
+    updateFlagFilter();
     connect(this, &NoDirSortProxyModel::searchParametersChanged, [&]() {
+        updateFlagFilter();
         updateSearchTerm();
     });
 }
 
-NoDirSortProxyModel::~NoDirSortProxyModel() {}
+NoDirSortProxyModel::~NoDirSortProxyModel() {
+    if (m_filterCancel)
+        *m_filterCancel = true;
+}
 
 QString NoDirSortProxyModel::searchTerm() const {
     return m_searchTerm;
@@ -39,7 +100,7 @@ void NoDirSortProxyModel::setSearchTerm(const QString &term) {
         return;
 
     m_searchTerm = term;
-    updateSearchTerm();
+    scheduleFilter(); // the matches of earlier terms stay usable
 
     emit searchTermChanged();
 }
@@ -73,52 +134,169 @@ void NoDirSortProxyModel::setSearchInChannelNames(bool enabled) {
 
 bool NoDirSortProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
 {
-    QFileSystemModel *fsm = qobject_cast<QFileSystemModel*>(sourceModel());
+    FileSystemModel *fsm = qobject_cast<FileSystemModel *>(sourceModel());
     Q_ASSERT(fsm);
     if (!fsm) {
         return false;
     }
     bool asc = sortOrder() == Qt::AscendingOrder ? true : false;
 
-    QFileInfo leftFileInfo  = fsm->fileInfo(left);
-    QFileInfo rightFileInfo = fsm->fileInfo(right);
-
-    // If DotAndDot move in the beginning
-    if (sourceModel()->data(left).toString() == "..")
-        return asc;
-    if (sourceModel()->data(right).toString() == "..")
-        return !asc;
+    const bool leftIsDir = fsm->isDir(left);
+    const bool rightIsDir = fsm->isDir(right);
 
     // Move dirs up
-    if (!leftFileInfo.isDir() && rightFileInfo.isDir()) {
+    if (!leftIsDir && rightIsDir) {
         return !asc;
     }
-    if (leftFileInfo.isDir() && !rightFileInfo.isDir()) {
+    if (leftIsDir && !rightIsDir) {
         return asc;
     }
 
-    if (leftFileInfo.isDir() && rightFileInfo.isDir()) {
+    if (leftIsDir && rightIsDir) {
         // Sort dirs alphabetically
-        return leftFileInfo.fileName() < rightFileInfo.fileName();
+        return fsm->fileName(left) < fsm->fileName(right);
     }
 
-    // uses file modification date
-    return QSortFilterProxyModel::lessThan(left, right);
+    // Precomputed creation time, nothing is read through data()
+    return fsm->sortKey(left) < fsm->sortKey(right);
 }
 
+// The search options changed, earlier matches no longer apply
 void NoDirSortProxyModel::updateSearchTerm() {
-    QString pattern;
-    if (!m_searchTerm.isEmpty())
-        pattern = ".*" + QRegularExpression::escape(m_searchTerm) + ".*";
+    m_searchSteps.clear();
+    scheduleFilter();
+}
+
+// Evaluates the filter for every video on a worker, over a FilterSnapshot of the source,
+// and applies the outcome in one go with applyFilter(). A newer call cancels the pass in
+// flight. The text lookup reuses earlier matches: a term that contains the previous one
+// can only match a subset of its rows, so only those are checked, and going back to an
+// earlier term reuses its rows. Fuzzy matching is not monotonic, it always does a full
+// lookup.
+void NoDirSortProxyModel::scheduleFilter() {
+    FileSystemModel *fsm = qobject_cast<FileSystemModel *>(sourceModel());
+    if (m_filterCancel)
+        *m_filterCancel = true;
+    const quint64 job = ++m_filterJob;
+    m_matches.clear(); // another term or other options
+    if (!fsm || !fsm->ready()) {
+        invalidateFilter();
+        return;
+    }
 
-    setFilterRegularExpression(QRegularExpression(pattern,
-                                                  QRegularExpression::CaseInsensitiveOption));
+    const FilterSnapshot snapshot = fsm->filterSnapshot(m_workingDirRoot, !m_searchTerm.isEmpty());
+    if (snapshot.searchGeneration != m_stepsGeneration) {
+        m_searchSteps.clear();
+        m_stepsGeneration = snapshot.searchGeneration;
+    }
+    while (!m_searchSteps.isEmpty()
+           && (m_fuzzySearch || !m_searchTerm.contains(m_searchSteps.last().term, Qt::CaseInsensitive)))
+        m_searchSteps.removeLast();
+
+    auto params = QSharedPointer<FilterParams>::create();
+    params->acceptedFlags = m_acceptedFlags;
+    params->workingDirFilter = !m_workingDirRoot.isEmpty();
+    params->searchInSaved = m_searchInSaved;
+    params->searchInUnsaved = m_searchInUnsaved;
+    params->term = m_searchTerm;
+    params->titles = searchInTitlesOrDefault();
+    params->channels = m_searchInChannelNames;
+    params->fuzzy = m_fuzzySearch;
+    if (!m_searchSteps.isEmpty()) {
+        params->rows = m_searchSteps.last().rows;
+        params->reuse = m_searchSteps.last().term.size() == m_searchTerm.size();
+        params->narrow = !params->reuse;
+    }
+
+    m_filterCancel.reset(new std::atomic_bool(false));
+    const auto cancel = m_filterCancel;
+    // Only copied on the worker, they are tested back on the GUI thread. A cancelled pass
+    // is never posted, and the destructor cancels.
+    QPointer<NoDirSortProxyModel> self(this);
+    QPointer<FileSystemModel> source(fsm);
+    QThreadPool::globalInstance()->start([=]() {
+        FilterSnapshot s = snapshot;
+        if (!s.searchIndexed && !params->term.isEmpty()) {
+            if (!FileSystemModel::buildSearchIndex(s, *cancel))
+                return;
+            // Posted first, so that the source has it when the pass is applied
+            QMetaObject::invokeMethod(qApp, [source, search = s.search,
+                                             tableGeneration = s.table.generation(),
+                                             searchGeneration = s.searchGeneration]() {
+                if (source)
+                    source->adoptSearchIndex(search, tableGeneration, searchGeneration);
+            }, Qt::QueuedConnection);
+        }
+        FilterPass pass;
+        pass.accepted = evaluate(s, *params, *cancel);
+        if (*cancel)
+            return;
+        pass.job = job;
+        pass.tableGeneration = s.table.generation();
+        pass.searchGeneration = s.searchGeneration;
+        if (!params->term.isEmpty()) {
+            pass.matches = params->rows;
+            pass.newStep = !params->fuzzy && !params->reuse;
+        }
+        QMetaObject::invokeMethod(qApp, [self, pass]() {
+            if (self)
+                self->applyFilter(pass);
+        }, Qt::QueuedConnection);
+    });
+}
+
+// One filter pass over the applied outcome: filterAcceptsRow() only tests a bit per row,
+// except for rows that changed since the snapshot, or came after it, which it evaluates
+// on the current state
+void NoDirSortProxyModel::applyFilter(const FilterPass &pass) {
+    FileSystemModel *fsm = qobject_cast<FileSystemModel *>(sourceModel());
+    if (pass.job != m_filterJob || !fsm)
+        return;
+    if (!m_searchTerm.isEmpty()) {
+        if (pass.newStep && pass.searchGeneration == fsm->searchGeneration()
+                && pass.searchGeneration == m_stepsGeneration) {
+            m_searchSteps.append({m_searchTerm, pass.matches});
+            if (m_searchSteps.size() > maxSearchSteps)
+                m_searchSteps.removeFirst();
+        }
+        m_matches = QBitArray(fsm->table().rowCount());
+        for (int r : pass.matches) {
+            if (r < m_matches.size())
+                m_matches.setBit(r);
+        }
+        m_matchesGeneration = pass.tableGeneration;
+    }
+    m_accepted = pass.accepted;
+    m_acceptedGeneration = pass.tableGeneration;
+    m_applying = true;
+    invalidateFilter();
+    m_applying = false;
+}
+
+// The outcome of the last pass for the rows it saw as they are now. The others, changed
+// since or not there yet, only need their own texts, nothing is looked up in the index.
+bool NoDirSortProxyModel::matchesSearch(const FileSystemModel *fsm, MetadataTable::RowId row) const {
+    if (row < m_matches.size() && fsm->table().changedAt(row) <= m_matchesGeneration)
+        return m_matches.testBit(row);
+    return fsm->videoMatches(row, m_searchTerm, searchInTitlesOrDefault(), m_searchInChannelNames,
+                             m_fuzzySearch);
+}
+
+void NoDirSortProxyModel::updateFlagFilter() {
+    for (int f = 0; f < MetadataTable::FilterFlagsCount; ++f) {
+        const bool starred = f & MetadataTable::Starred;
+        const bool shortVideo = f & MetadataTable::Short;
+        const bool opened = !shortVideo && (f & MetadataTable::Opened);
+        const bool viewed = !shortVideo && (f & MetadataTable::Viewed);
+        m_acceptedFlags[f] = (starred ? m_searchInStarred : m_searchInUnstarred)
+                          && (!shortVideo || m_searchInShorts)
+                          && (opened ? m_searchInOpened : m_searchInUnopened)
+                          && (viewed ? m_searchInWatched : m_searchInUnwatched);
+    }
 }
 
 bool NoDirSortProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
 {
-    QRegularExpression re = filterRegularExpression();
-
     FileSystemModel *fsm = qobject_cast<FileSystemModel *>(sourceModel());
     Q_ASSERT(fsm);
     if (!fsm) {
@@ -128,28 +306,24 @@ bool NoDirSortProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sou
     QModelIndex nameIndex = fsm->index(sourceRow, 0, sourceParent);
     const bool isDir = fsm->isDir(nameIndex);
 
+    const MetadataTable::RowId row = fsm->tableRow(nameIndex);
+    if (m_applying && row >= 0 && row < m_accepted.size() // a pass of scheduleFilter()
+            && fsm->table().changedAt(row) <= m_acceptedGeneration)
+        return m_accepted.testBit(row);
+
+    // Rows mapped for the first time, or changed since the last pass: evaluated here, on
+    // the current state, which is all in memory
     const QString key = fsm->data(nameIndex, FileSystemModel::FileNameRole).toString();
 
     if (isDir) {
         return key.contains(allowedDirsPattern);
     }
 
-    QString title = fsm->data(nameIndex, FileSystemModel::TitleRole).toString();
-
-    const bool starred = fsm->isStarred(key);
-    if ((starred && !m_searchInStarred) || (!starred && !m_searchInUnstarred))
-        return false;
-
-    const bool shortVideo = YaycUtilities::isShortVideo(key);
-    if (shortVideo && !m_searchInShorts)
-        return false;
-
-    const bool opened = !shortVideo && fsm->duration(key) > 0.;
-    if ((opened && !m_searchInOpened) || (!opened && !m_searchInUnopened))
-        return false;
-
-    const bool viewed = !shortVideo && fsm->isViewed(key);
-    if ((viewed && !m_searchInWatched) || (!viewed && !m_searchInUnwatched))
+    const MetadataTable &table = fsm->table();
+    const quint8 flags = (row < 0) // not cached (yet)
+            ? (YaycUtilities::isShortVideo(key) ? MetadataTable::Short : 0)
+            : table.flags(row);
+    if (!m_acceptedFlags[flags])
         return false;
 
     if (!m_workingDirRoot.isEmpty()) { // if m_workingDirRoot is unset, the following filter should be ignored
@@ -158,27 +332,14 @@ bool NoDirSortProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sou
             return false;
     }
 
-    if (re.pattern().isEmpty())
+    if (m_searchTerm.isEmpty())
         return true;
 
-    const QString channelName =
-            fsm->data(nameIndex, FileSystemModel::ChannelNameRole).toString();
-
-    const QString channelId =
-            fsm->data(nameIndex, FileSystemModel::ChannelIdRole).toString();
-
-    bool searchInTitles = m_searchInTitles || (!m_searchInTitles && !m_searchInChannelNames);
+    const bool searchInTitles = searchInTitlesOrDefault();
 
-    bool res = false;
-    if (searchInTitles) {
-        res |= title.contains(re);
-        res |= key.contains(re);
-    }
-    if (m_searchInChannelNames) {
-        res |= channelName.contains(re);
-        res |= channelId.contains(re);
-    }
+    if (row < 0) // only the key is known
+        return searchInTitles && key.contains(m_searchTerm, Qt::CaseInsensitive);
 
-    return res;
+    return matchesSearch(fsm, row);
 }
 
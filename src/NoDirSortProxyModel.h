@@ -19,8 +19,15 @@ In addition to the above,
 #define NODIRSORTPROXYMODEL_H
 
 #include <QSortFilterProxyModel>
-#include <QFileSystemModel>
 #include <QRegularExpression>
+#include <QBitArray>
+#include <QSharedPointer>
+#include <array>
+#include <atomic>
+
+#include "MetadataTable.h"
+
+class FileSystemModel;
 
 class NoDirSortProxyModel : public QSortFilterProxyModel {
     Q_OBJECT
@@ -39,6 +46,35 @@ class NoDirSortProxyModel : public QSortFilterProxyModel {
     bool m_searchInUnsaved{true};
     bool m_searchInShorts{true};
     QString m_workingDirRoot;
+    bool m_fuzzySearch{false}; // typo tolerant word matching instead of substrings, see FuzzyIndex
+    // Outcome of the starred/shorts/opened/watched filters for every MetadataTable flag combination
+    std::array<bool, MetadataTable::FilterFlagsCount> m_acceptedFlags;
+    // Text matches of earlier terms, see scheduleFilter()
+    struct SearchStep {
+        QString term;
+        QList<int> rows; // MetadataTable rows, ascending
+    };
+    QList<SearchStep> m_searchSteps; // each term contains the previous one
+    quint64 m_stepsGeneration{0}; // source search generation the steps belong to
+    static constexpr int maxSearchSteps = 64;
+    // Filter passes run on a worker, see scheduleFilter()
+    struct FilterPass {
+        quint64 job{0};
+        quint64 tableGeneration{0}; // of the snapshot the pass ran on
+        quint64 searchGeneration{0};
+        QBitArray accepted; // by MetadataTable row
+        QList<int> matches; // MetadataTable rows matching the term, ascending
+        bool newStep{false}; // matches are worth keeping as a SearchStep
+    };
+    QBitArray m_accepted; // outcome of the last pass, by MetadataTable row
+    quint64 m_acceptedGeneration{0}; // rows changed after it are evaluated again
+    bool m_applying{false}; // filterAcceptsRow() answers from m_accepted
+    quint64 m_filterJob{0};
+    QSharedPointer<std::atomic_bool> m_filterCancel;
+    // Rows matching the current term as of the last pass, rows changed after it are matched
+    // on their own texts, see matchesSearch()
+    QBitArray m_matches;
+    quint64 m_matchesGeneration{0}; // table generation of the pass
 
     Q_PROPERTY(QString searchTerm READ searchTerm WRITE setSearchTerm NOTIFY searchTermChanged)
     Q_PROPERTY(bool searchInTitles READ searchInTitles WRITE setSearchInTitles NOTIFY searchInTitlesChanged)
@@ -54,6 +90,7 @@ class NoDirSortProxyModel : public QSortFilterProxyModel {
     Q_PROPERTY(bool searchInUnsaved MEMBER m_searchInUnsaved NOTIFY searchParametersChanged)
     Q_PROPERTY(bool searchInShorts MEMBER m_searchInShorts NOTIFY searchParametersChanged)
     Q_PROPERTY(QString workingDirRoot MEMBER m_workingDirRoot NOTIFY searchParametersChanged)
+    Q_PROPERTY(bool fuzzySearch MEMBER m_fuzzySearch NOTIFY searchParametersChanged)
 
 public:
     NoDirSortProxyModel();
@@ -68,6 +105,7 @@ public:
 
     bool lessThan(const QModelIndex &left, const QModelIndex &right) const override;
     void updateSearchTerm();
+    void updateFlagFilter();
 
 signals:
     void searchTermChanged();
@@ -77,6 +115,12 @@ signals:
 
 protected:
     bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+private:
+    void scheduleFilter();
+    void applyFilter(const FilterPass &pass);
+    bool matchesSearch(const FileSystemModel *fsm, MetadataTable::RowId row) const;
+    bool searchInTitlesOrDefault() const { return m_searchInTitles || !m_searchInChannelNames; }
 };
 
 #endif // NODIRSORTPROXYMODEL_H
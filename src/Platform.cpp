@@ -20,6 +20,10 @@ In addition to the above,
 // Constants
 const QString videoExtension{"yayc"};
 const QString channelExtension{"yaycc"};
+const QString journalFileName{".yayc.journal"};
+const QString cborMarkerFileName{".yayc.cbor"};
+const QString positionLogFileName{".yayc.positions"};
+const QString historyArchiveFileName{".yayc.archive"};
 const QString shortsVideoPattern{"https://youtube.com/shorts/"};
 const QString standardVideoPattern{"https://youtube.com/watch?v="};
 const QString youtubeHomePattern{"https://youtube.com"};
@@ -41,7 +45,7 @@ QString videoType(const QString &key) {
 }
 
 bool isShorts(const QString &key) {
-    return videoType(key).startsWith('s');
+    return key.size() > 3 && key.at(3) == u's';
 }
 
 QString videoVendor(const QString &key) {
@@ -83,13 +87,15 @@ QString Platform::toString(const Vendor &v) {
 }
 
 Platform::Vendor Platform::toVendor(const QString &name) {
-    static QMap<QString, Vendor> reverseLUT;
-    if (reverseLUT.empty()) {
+    // Built once, thread-safely: metadata files are parsed from a thread pool
+    static const QMap<QString, Vendor> reverseLUT = [] {
+        QMap<QString, Vendor> lut;
         for (unsigned int e = UNK; e <= YTB; ++e) {
             QMetaEnum metaEnum = QMetaEnum::fromType<Platform::Vendor>();
-            reverseLUT[metaEnum.valueToKey(e)] = Vendor(e);
+            lut[metaEnum.valueToKey(e)] = Vendor(e);
         }
-    }
+        return lut;
+    }();
     auto res = reverseLUT.find(name);
     if (res != reverseLUT.end())
         return res.value();
@@ -31,6 +31,10 @@ In addition to the above,
 // Constants
 extern const QString videoExtension;
 extern const QString channelExtension;
+extern const QString journalFileName;
+extern const QString cborMarkerFileName;
+extern const QString positionLogFileName;
+extern const QString historyArchiveFileName;
 extern const QString shortsVideoPattern;
 extern const QString standardVideoPattern;
 extern const QString youtubeHomePattern;
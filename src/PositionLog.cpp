@@ -0,0 +1,126 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#include "PositionLog.h"
+#include "MetadataWriter.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QDateTime>
+#include <QtEndian>
+#include <QDebug>
+
+#include <cstring>
+
+namespace {
+constexpr qsizetype checksumOffset = PositionLog::recordSize - 2;
+
+template <typename T>
+void put(char *dst, T value) {
+    qToLittleEndian(value, dst);
+}
+
+void putReal(char *dst, qreal value) {
+    const double d = value;
+    quint64 bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    put(dst, bits);
+}
+
+qreal getReal(const char *src) {
+    const quint64 bits = qFromLittleEndian<quint64>(src);
+    double d;
+    std::memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+}
+
+PositionLog::PositionLog(const QDir &root, MetadataWriter *writer)
+    : m_root(root), m_writer(writer) {
+    m_logged = QFileInfo::exists(filePath());
+}
+
+QString PositionLog::filePath() const {
+    return m_root.absoluteFilePath(positionLogFileName);
+}
+
+void PositionLog::record(const VideoKey &key, qreal position, qreal duration) {
+    if (!key.isPersistent())
+        return;
+    char rec[recordSize] = {};
+    put(rec, key.bits());
+    putReal(rec + 8, position);
+    putReal(rec + 16, duration);
+    put(rec + 24, quint32(QDateTime::currentSecsSinceEpoch()));
+    rec[28] = char(key.tag());
+    put(rec + checksumOffset, qChecksum(QByteArrayView(rec, checksumOffset)));
+    m_buffer.append(rec, recordSize);
+}
+
+// One append per call, however many ticks were buffered since the last one
+void PositionLog::commit() {
+    if (m_buffer.isEmpty())
+        return;
+    m_writer->append(filePath(), m_buffer);
+    m_buffer.clear();
+    m_logged = true;
+}
+
+int PositionLog::replay(QHash<QString, VideoMetadata> &videos) {
+    QFile f(filePath());
+    if (!f.exists() || !f.open(QIODevice::ReadOnly))
+        return 0;
+    const QByteArray data = f.readAll();
+    f.close();
+
+    QSet<QString> updated;
+    const char *rec = data.constData();
+    for (qsizetype i = 0; i + recordSize <= data.size(); i += recordSize, rec += recordSize) {
+        if (qFromLittleEndian<quint16>(rec + checksumOffset)
+                != qChecksum(QByteArrayView(rec, checksumOffset))) {
+            qWarning() << "Skipping corrupt position record in " << f.fileName() << " at " << i;
+            continue;
+        }
+        const VideoKey key = VideoKey::fromBits(qFromLittleEndian<quint64>(rec), quint8(rec[28]));
+        if (key.isNull())
+            continue;
+        auto it = videos.find(key.toString());
+        if (it == videos.end()) // erased since
+            continue;
+        // Same order as VideoMetadata::update(), so viewed flips the same way
+        it->setPosition(getReal(rec + 8));
+        it->setDuration(getReal(rec + 16));
+        if (it->dirty)
+            updated.insert(it.key());
+    }
+    // Cut a torn tail, or every record appended from now on would be misaligned behind it
+    const qsizetype whole = data.size() - data.size() % recordSize;
+    if (whole != data.size() && !f.resize(whole))
+        qWarning() << "Failed truncating " << f.fileName() << " : " << f.errorString();
+    m_logged = whole > 0;
+    return int(updated.size());
+}
+
+// Called by sync() after it queued the records, the writer keeps this replace behind them
+void PositionLog::checkpoint() {
+    m_buffer.clear();
+    if (!m_logged)
+        return;
+    m_writer->replace(filePath(), QByteArray());
+    m_logged = false;
+}
@@ -0,0 +1,68 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#ifndef POSITIONLOG_H
+#define POSITIONLOG_H
+
+#include "VideoKey.h"
+#include "VideoMetadata.h"
+
+class MetadataWriter;
+
+#include <QDir>
+#include <QHash>
+#include <QString>
+#include <QByteArray>
+
+// Write-ahead log of playback positions, next to the records of a root.
+// While a video plays, updateEntry() changes its position every few seconds. Each change
+// is logged as one fixed size record instead of waiting for sync() to rewrite the whole
+// .yayc file (little endian):
+//   0  quint64 VideoKey::bits()
+//   8  double  position
+//   16 double  duration
+//   24 quint32 timestamp, seconds since epoch
+//   28 quint8  VideoKey::tag()
+//   29 quint8  reserved
+//   30 quint16 qChecksum() of bytes 0-29, a torn tail fails it
+// Records are buffered and group committed by commit(). On startup replay() applies the log
+// on top of the loaded records. checkpoint() truncates it once sync() has queued the full
+// records, which then carry the same positions.
+class PositionLog
+{
+public:
+    static constexpr qsizetype recordSize = 32;
+
+    PositionLog(const QDir &root, MetadataWriter *writer);
+
+    QString filePath() const;
+    bool hasBuffered() const { return !m_buffer.isEmpty(); }
+
+    // Keys that can't be persisted (see VideoKey::isPersistent) are left to sync()
+    void record(const VideoKey &key, qreal position, qreal duration);
+    void commit();
+    int replay(QHash<QString, VideoMetadata> &videos); // returns the number of updated records
+    void checkpoint();
+
+private:
+    QDir m_root;
+    MetadataWriter *m_writer{nullptr};
+    QByteArray m_buffer; // records not yet handed to the writer
+    bool m_logged{false}; // the file may hold records
+};
+
+#endif // POSITIONLOG_H
@@ -0,0 +1,160 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#include "RecordFormat.h"
+#include "Platform.h"
+#include "VideoMetadata.h"
+#include "ChannelMetadata.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDirIterator>
+#include <QCborStreamReader>
+#include <QDebug>
+
+namespace {
+bool isStoredAs(const QString &path, RecordFormat::Format format) {
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+    return RecordFormat::isCbor(f.peek(3)) == (format == RecordFormat::Cbor);
+}
+}
+
+RecordFormat::Format RecordFormat::of(const QDir &root) {
+    return root.exists(cborMarkerFileName) ? Cbor : Json;
+}
+
+bool RecordFormat::isCbor(const QByteArray &data) {
+    // Self-describe tag 55799, never a valid start for JSON text
+    return data.size() >= 3
+           && quint8(data.at(0)) == 0xd9
+           && quint8(data.at(1)) == 0xd9
+           && quint8(data.at(2)) == 0xf7;
+}
+
+int RecordFormat::migrate(const QDir &root, Format format, int *skipped) {
+    if (!root.exists()) {
+        qWarning() << "RecordFormat::migrate: " << root.absolutePath() << " does not exist.";
+        return -1;
+    }
+
+    int migrated = 0;
+    int unreadable = 0;
+    QDirIterator it(root.absolutePath(),
+                    {QLatin1String("*.") + videoExtension},
+                    QDir::Files,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QFileInfo fi(it.next());
+        if (!fi.size() || isStoredAs(fi.absoluteFilePath(), format)) // journal placeholder, or done
+            continue;
+        VideoMetadata v(fi.baseName(), fi.dir());
+        if (!v.loadFile()) { // saving it would replace the file with an empty record
+            ++unreadable;
+            continue;
+        }
+        v.dirty = true;
+        v.saveFile(format);
+        ++migrated;
+    }
+
+    QDir channelsDir(root);
+    if (channelsDir.cd(".channels")) {
+        const auto channelFiles = channelsDir.entryInfoList({QLatin1String("*.") + channelExtension},
+                                                            QDir::Files);
+        for (const auto &fi : channelFiles) {
+            if (isStoredAs(fi.absoluteFilePath(), format))
+                continue;
+            ChannelMetadata c(fi.fileName().chopped(channelExtension.length() + 1), channelsDir);
+            if (!c.loadFile()) {
+                ++unreadable;
+                continue;
+            }
+            c.dirty = true;
+            c.saveFile(format);
+            ++migrated;
+        }
+    }
+
+    QFile marker(root.absoluteFilePath(cborMarkerFileName));
+    if (format == Cbor && !marker.exists() && !marker.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed creating " << marker.fileName();
+        return -1;
+    }
+    if (format == Json && marker.exists() && !marker.remove()) {
+        qWarning() << "Failed removing " << marker.fileName();
+        return -1;
+    }
+    if (skipped)
+        *skipped = unreadable;
+    return migrated;
+}
+
+QString RecordFormat::readString(QCborStreamReader &r) {
+    QString res;
+    if (!r.isString()) {
+        r.next();
+        return res;
+    }
+    auto chunk = r.readString();
+    while (chunk.status == QCborStreamReader::Ok) {
+        res += chunk.data;
+        chunk = r.readString();
+    }
+    return res;
+}
+
+QByteArray RecordFormat::readBytes(QCborStreamReader &r) {
+    QByteArray res;
+    if (!r.isByteArray()) {
+        r.next();
+        return res;
+    }
+    auto chunk = r.readByteArray();
+    while (chunk.status == QCborStreamReader::Ok) {
+        res += chunk.data;
+        chunk = r.readByteArray();
+    }
+    return res;
+}
+
+double RecordFormat::readDouble(QCborStreamReader &r) {
+    double res = 0.;
+    if (r.isDouble())
+        res = r.toDouble();
+    else if (r.isFloat())
+        res = r.toFloat();
+    else if (r.isInteger())
+        res = double(r.toInteger());
+    r.next();
+    return res;
+}
+
+qint64 RecordFormat::readInteger(QCborStreamReader &r) {
+    qint64 res = -1;
+    if (r.isInteger())
+        res = qint64(r.toInteger());
+    r.next();
+    return res;
+}
+
+bool RecordFormat::readBool(QCborStreamReader &r) {
+    const bool res = r.isBool() && r.toBool();
+    r.next();
+    return res;
+}
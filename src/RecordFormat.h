@@ -0,0 +1,58 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#ifndef RECORDFORMAT_H
+#define RECORDFORMAT_H
+
+#include <QDir>
+#include <QString>
+#include <QByteArray>
+
+class QCborStreamReader;
+
+// On-disk encoding of the .yayc/.yaycc files of a root.
+// Json: indented JSON text, binary fields as base64 (the historical format).
+// Cbor: a map with small integer keys and raw byte strings, prefixed by the CBOR
+//       self-describe tag (d9 d9 f7) and carrying a format version.
+// Loaders detect the encoding per file, so a root can be read while half migrated.
+// The format new writes use is a per-root choice, marked by an empty cborMarkerFileName.
+class RecordFormat
+{
+public:
+    enum Format {
+        Json = 0,
+        Cbor
+    };
+    static constexpr quint64 cborVersion = 1;
+
+    static Format of(const QDir &root);
+    static bool isCbor(const QByteArray &data);
+
+    // Rewrites every record under root in the given format and updates the marker.
+    // Returns the number of rewritten files, -1 on failure. Records that cannot be read or
+    // decoded are left as they are and counted in skipped.
+    static int migrate(const QDir &root, Format format, int *skipped = nullptr);
+
+    // Each consumes the current item, mismatching types yield a default value
+    static QString readString(QCborStreamReader &r);
+    static QByteArray readBytes(QCborStreamReader &r);
+    static double readDouble(QCborStreamReader &r);
+    static qint64 readInteger(QCborStreamReader &r);
+    static bool readBool(QCborStreamReader &r);
+};
+
+#endif // RECORDFORMAT_H
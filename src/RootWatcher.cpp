@@ -0,0 +1,76 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#include "RootWatcher.h"
+
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QDebug>
+
+RootWatcher::RootWatcher(const QDir &root, QObject *parent) : QObject(parent) {
+    m_debounce.setSingleShot(true);
+    m_debounce.setInterval(500);
+    connect(&m_debounce, &QTimer::timeout, this, &RootWatcher::flush);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged,
+            this, &RootWatcher::onDirectoryChanged);
+    watchTree(root.absolutePath());
+}
+
+void RootWatcher::watchTree(const QString &path) {
+    QStringList dirs;
+    if (!m_watched.contains(path))
+        dirs.append(path);
+    QDirIterator it(path, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString d = it.next();
+        if (!m_watched.contains(d))
+            dirs.append(d);
+    }
+    if (dirs.isEmpty())
+        return;
+    const QStringList failed = m_watcher.addPaths(dirs);
+    if (!failed.isEmpty())
+        qWarning() << "RootWatcher: unable to watch " << failed.size() << " directories under " << path;
+    for (const auto &d : std::as_const(dirs))
+        m_watched.insert(d);
+    for (const auto &d : failed)
+        m_watched.remove(d);
+}
+
+// Every notification restarts the timer, the batch goes out once the tree is quiet,
+// or after maxDelay when it never is
+void RootWatcher::onDirectoryChanged(const QString &path) {
+    if (m_paused)
+        return;
+    if (m_pending.isEmpty())
+        m_batchAge.start();
+    m_pending.insert(path);
+    if (!m_debounce.isActive() || m_batchAge.elapsed() < maxDelay)
+        m_debounce.start();
+}
+
+void RootWatcher::flush() {
+    QStringList paths(m_pending.cbegin(), m_pending.cend());
+    m_pending.clear();
+    for (const auto &p : std::as_const(paths)) {
+        if (!QFileInfo::exists(p)) { // renamed or removed, a watch may linger on the old name
+            m_watcher.removePath(p);
+            m_watched.remove(p);
+        }
+    }
+    emit directoriesChanged(paths);
+}
@@ -0,0 +1,66 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#ifndef ROOTWATCHER_H
+#define ROOTWATCHER_H
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+// Change feed for the category tree of a root, to pick up edits made outside the app
+// (file managers, rsync, another machine). Every non hidden directory below the root is
+// watched. Notifications are collected until the tree has been quiet for debounce ms,
+// then delivered as one batch, so a large external sync becomes a single update.
+// Directories that went away are reported too, and stop being watched.
+class RootWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RootWatcher(const QDir &root, QObject *parent = nullptr);
+
+    void watchTree(const QString &path); // path and every directory below it
+    bool isWatched(const QString &path) const { return m_watched.contains(path); }
+    void setDebounce(int ms) { m_debounce.setInterval(ms); }
+    // While paused notifications are dropped, for bulk changes the owner applies itself
+    void setPaused(bool paused) { m_paused = paused; }
+    bool isPaused() const { return m_paused; }
+
+    static constexpr qint64 maxDelay = 5000; // ms, for a tree that keeps changing
+
+signals:
+    void directoriesChanged(const QStringList &paths);
+
+private:
+    void onDirectoryChanged(const QString &path);
+    void flush();
+
+    QFileSystemWatcher m_watcher;
+    QTimer m_debounce;
+    QElapsedTimer m_batchAge;
+    QSet<QString> m_watched;
+    QSet<QString> m_pending;
+    bool m_paused{false};
+};
+
+#endif // ROOTWATCHER_H
@@ -0,0 +1,76 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+#include "SearchIndexes.h"
+
+#include <algorithm>
+#include <iterator>
+
+bool SearchIndexes::insert(int row, const QString &key, const QString &title,
+                           const QString &channelId, const QString &channelName) {
+    const bool titleUpdated = m_titles.insert(row, title + QLatin1Char('\n') + key);
+    const bool channelUpdated = m_channels.insert(row, channelName + QLatin1Char('\n') + channelId);
+    const bool wordsUpdated = m_words.insert(row, title, channelName);
+    return titleUpdated || channelUpdated || wordsUpdated;
+}
+
+void SearchIndexes::remove(int row) {
+    m_titles.remove(row);
+    m_channels.remove(row);
+    m_words.remove(row);
+}
+
+void SearchIndexes::clear() {
+    m_titles.clear();
+    m_channels.clear();
+    m_words.clear();
+}
+
+QList<int> SearchIndexes::find(const QString &term, bool titles, bool channels, bool fuzzy,
+                               const QList<int> *within) const {
+    QList<int> res;
+    if (fuzzy) {
+        const auto hits = m_words.find(term, titles, channels, within);
+        res.reserve(hits.size());
+        for (const auto &h : hits)
+            res.append(h.doc);
+        return res;
+    }
+    const auto lookup = [&term, within](const TrigramIndex &index) {
+        return within ? index.narrow(term, *within) : index.find(term);
+    };
+    const QList<int> inTitles = titles ? lookup(m_titles) : QList<int>();
+    const QList<int> inChannels = channels ? lookup(m_channels) : QList<int>();
+    res.reserve(inTitles.size() + inChannels.size());
+    std::set_union(inTitles.cbegin(), inTitles.cend(), inChannels.cbegin(), inChannels.cend(),
+                   std::back_inserter(res));
+    return res;
+}
+
+bool SearchIndexes::matches(const QString &term, bool titles, bool channels, bool fuzzy,
+                            const QString &key, const QString &title,
+                            const QString &channelId, const QString &channelName) {
+    if (fuzzy) {
+        FuzzyIndex words;
+        words.insert(0, title, channelName);
+        return !words.find(term, titles, channels).isEmpty();
+    }
+    const QString folded = term.toCaseFolded();
+    const auto contains = [&folded](const QString &text, const QString &id) {
+        return (text + QLatin1Char('\n') + id).toCaseFolded().contains(folded);
+    };
+    return (titles && contains(title, key)) || (channels && contains(channelName, channelId));
+}
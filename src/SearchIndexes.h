@@ -0,0 +1,56 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+#ifndef SEARCHINDEXES_H
+#define SEARCHINDEXES_H
+
+#include "TrigramIndex.h"
+#include "FuzzyIndex.h"
+
+#include <QList>
+#include <QString>
+
+// The text indexes of a library, by MetadataTable row: title and key, and channel name and
+// id, for substrings; the words of title and channel name for fuzzy matching.
+// Only implicitly shared containers inside, so a copy costs a few reference counts and can
+// be read on another thread while the original keeps changing.
+class SearchIndexes
+{
+public:
+    // False when nothing changed, which is the case for most updates of a record
+    bool insert(int row, const QString &key, const QString &title,
+                const QString &channelId, const QString &channelName);
+    void remove(int row);
+    void clear();
+
+    // Rows whose title or key, and/or channel name or id, contain term case insensitively,
+    // ascending. With within, only those rows are checked. With fuzzy, the rows FuzzyIndex
+    // matches instead.
+    QList<int> find(const QString &term, bool titles, bool channels, bool fuzzy = false,
+                    const QList<int> *within = nullptr) const;
+    // find() for a single record, from its texts rather than an index
+    static bool matches(const QString &term, bool titles, bool channels, bool fuzzy,
+                        const QString &key, const QString &title,
+                        const QString &channelId, const QString &channelName);
+    const FuzzyIndex &words() const { return m_words; }
+
+private:
+    TrigramIndex m_titles;
+    TrigramIndex m_channels;
+    FuzzyIndex m_words;
+};
+
+#endif // SEARCHINDEXES_H
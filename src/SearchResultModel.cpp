@@ -0,0 +1,66 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+#include "SearchResultModel.h"
+
+SearchResultModel::SearchResultModel(QObject *parent) : QAbstractListModel(parent) {}
+
+void SearchResultModel::setResults(QList<Result> results) {
+    const bool countChanges = results.size() != m_results.size();
+    beginResetModel();
+    m_results = std::move(results);
+    endResetModel();
+    if (countChanges)
+        emit countChanged();
+}
+
+int SearchResultModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : int(m_results.size());
+}
+
+QVariant SearchResultModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= m_results.size())
+        return QVariant();
+    const Result &r = m_results.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+    case TitleRole:
+        return r.title;
+    case KeyRole:
+        return r.key;
+    case ChannelNameRole:
+        return r.channelName;
+    case CreatedRole:
+        return r.created;
+    case ScoreRole:
+        return r.score;
+    case StarredRole:
+        return r.starred;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> SearchResultModel::roleNames() const {
+    QHash<int, QByteArray> result = QAbstractListModel::roleNames();
+    result.insert(KeyRole, QByteArrayLiteral("key"));
+    result.insert(TitleRole, QByteArrayLiteral("title"));
+    result.insert(ChannelNameRole, QByteArrayLiteral("channelName"));
+    result.insert(CreatedRole, QByteArrayLiteral("created"));
+    result.insert(ScoreRole, QByteArrayLiteral("score"));
+    result.insert(StarredRole, QByteArrayLiteral("starred"));
+    return result;
+}
@@ -0,0 +1,68 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+#ifndef SEARCHRESULTMODEL_H
+#define SEARCHRESULTMODEL_H
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QString>
+
+// Flat list of ranked search results, best first, for the ranked search view.
+// Filled in one go by FileSystemModel::rankedSearch(); the rows are copies, so the list
+// stays valid while the library changes and is only refreshed by the next search.
+class SearchResultModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ rowCount NOTIFY countChanged)
+
+public:
+    struct Result {
+        QString key;
+        QString title;
+        QString channelName;
+        QString created;
+        float score{0.0f};
+        bool starred{false};
+    };
+
+    enum Roles {
+        KeyRole = Qt::UserRole + 1,
+        TitleRole,
+        ChannelNameRole,
+        CreatedRole,
+        ScoreRole,
+        StarredRole,
+    };
+    Q_ENUM(Roles)
+
+    explicit SearchResultModel(QObject *parent = nullptr);
+
+    void setResults(QList<Result> results);
+    const QList<Result> &results() const { return m_results; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+signals:
+    void countChanged();
+
+private:
+    QList<Result> m_results;
+};
+
+#endif // SEARCHRESULTMODEL_H
@@ -20,6 +20,7 @@ In addition to the above,
 #include "ThumbnailImageProvider.h"
 #include "Platform.h"
 #include "ChannelMetadata.h"
+#include "ThumbnailStore.h"
 
 #include <QNetworkRequest>
 #include <QNetworkReply>
@@ -27,6 +28,7 @@ In addition to the above,
 #include <QLoggingCategory>
 #include <QQmlApplicationEngine>
 #include <QTextDocument>
+#include <QThreadPool>
 
 ThumbnailFetcher::ThumbnailFetcher(QObject *parent) : QObject(parent) {
     m_nam.setCookieJar(new QNetworkCookieJar);
@@ -68,6 +70,42 @@ void ThumbnailFetcher::fetchMissing() {
     instance.fetchMissingThumbnails();
 }
 
+// Once per session, as soon as every model has its root: each publishes the thumbnails it
+// refers to, then the store drops the blobs nobody does. The caches are copied for the
+// worker, that is cheap as they are implicitly shared.
+void ThumbnailFetcher::collectGarbage() {
+    static bool done = false;
+    if (done)
+        return;
+    struct Owner {
+        QString root;
+        QHash<QString, VideoMetadata> videos;
+        QSet<QString> archived;
+    };
+    QList<Owner> owners;
+    auto &instance = GetInstance();
+    for (auto &m : std::as_const(instance.m_models)) {
+        if (!m->m_ready)
+            return; // still loading, try again on the next sync
+        if (m->m_rootPath.isEmpty())
+            continue;
+        owners.append({m->m_rootPath, m->m_cache,
+                       m->m_archive ? m->m_archive->thumbnailRefs() : QSet<QString>()});
+    }
+    if (owners.isEmpty())
+        return;
+    done = true;
+    QThreadPool::globalInstance()->start([owners]() {
+        for (const auto &o : owners) {
+            if (!ThumbnailStore::publish(o.root, FileSystemModel::thumbnailRefs(o.videos) + o.archived))
+                return;
+        }
+        const int removed = ThumbnailStore::collect();
+        QLoggingCategory category("qmldebug");
+        qCInfo(category) << "Removed " << removed << " unused thumbnails";
+    });
+}
+
 void ThumbnailFetcher::printStats() {
     auto &instance = GetInstance();
     QLoggingCategory category("qmldebug");
@@ -168,10 +206,12 @@ void ThumbnailFetcher::onThumbnailRequestFinished() {
             ++m_failures;
         }
     } else {
-        if (auto m = bookmarksModel())
+        if (auto m = bookmarksModel()) {
+            const VideoMetadata *e = m->entry(key);
             qWarning() << "Error while retrieving thumbnail: " << reply->errorString() << " : "
-                       << reply->url() << " Channel: " << m->m_cache.value(key).channelID
-                       << " Video " << m->m_cache.value(key).title;
+                       << reply->url() << " Channel: " << (e ? e->channelID : QString())
+                       << " Video " << (e ? e->title : QString());
+        }
         ++m_failures;
     }
     reply->deleteLater();
@@ -266,33 +306,42 @@ void ThumbnailFetcher::onFetchAvatarRequestFinished() {
     reply->deleteLater();
 }
 
+// Whether the blobs are there is checked on a worker, only the missing ones come back
 void ThumbnailFetcher::fetchMissingThumbnails() {
     QSet<QString> missingKeys;
-    qDebug() << "Missing Thumbs:";
+    QList<QPair<QString, QString>> stored; // key, ref
     for (auto &m : std::as_const(m_models)) {
-        for (auto i = m->m_cache.begin(); i != m->m_cache.end(); ++i) {
-            if (!i.value().hasThumbnail()) {
+        for (auto i = m->m_cache.constBegin(); i != m->m_cache.constEnd(); ++i) {
+            if (i.value().thumbnailData.size())
+                continue;
+            if (i.value().thumbnailRef.isEmpty())
                 missingKeys.insert(i.key());
-                qDebug() << i.key() << " " << i.value().title;
-            }
+            else
+                stored.append({i.key(), i.value().thumbnailRef});
         }
     }
-    for (const auto &k : missingKeys) {
-        fetchThumbnail(k);
-    }
-    missingKeys.clear();
-    qDebug() << "Missing channel:";
+    QThreadPool::globalInstance()->start([missingKeys, stored]() mutable {
+        for (const auto &s : std::as_const(stored)) {
+            if (!ThumbnailStore::contains(s.second))
+                missingKeys.insert(s.first);
+        }
+        QMetaObject::invokeMethod(&GetInstance(), [missingKeys]() {
+            auto &instance = GetInstance();
+            for (const auto &k : missingKeys)
+                instance.fetchThumbnail(k);
+        }, Qt::QueuedConnection);
+    });
+
+    QSet<QString> missingChannels;
     if (auto m = bookmarksModel()) {
-        for (auto i = m->m_cache.begin(); i != m->m_cache.end(); ++i) {
-            if (i.value().channelID.isEmpty()) {
-                missingKeys.insert(i.key());
-                qDebug() << i.key() << " " << i.value().title;
-            }
+        for (auto i = m->m_cache.constBegin(); i != m->m_cache.constEnd(); ++i) {
+            if (i.value().channelID.isEmpty())
+                missingChannels.insert(i.key());
         }
     } else {
         qFatal("m_bookmarksModel is NULL!");
     }
-    for (const auto &k : missingKeys) {
+    for (const auto &k : missingChannels) {
         fetchChannelInternal(k);
     }
 }
@@ -38,6 +38,7 @@ public:
     static void fetchChannel(const QString &key);
     static void fetchChannelAvatar(const QString &channelKey, const QString &url);
     static void fetchMissing();
+    static void collectGarbage();
     static void printStats();
 
 private slots:
@@ -19,16 +19,25 @@ In addition to the above,
 #define THUMBNAILIMAGEPROVIDER_H
 
 #include "Platform.h"
+#include "ThumbnailStore.h"
+#include "VideoKey.h"
 
 #include <QQuickImageProvider>
 #include <QHash>
+#include <QCache>
 #include <QImage>
 #include <QMutex>
 
+// Serves image://videothumbnail/<key>. Models only register the ThumbnailStore reference of
+// each entry; the blob is read and decoded the first time the image is requested, and kept in
+// a cache bounded by decoded size (cost in KiB). Images handed over directly (just fetched,
+// or not in the store) are kept as they are.
 class ThumbnailImageProvider : public QQuickImageProvider
 {
     QBasicMutex m_mutex;
-    QHash<QString, QImage> m_images;
+    QHash<VideoKey, QImage> m_images;
+    QHash<VideoKey, QString> m_refs;
+    QCache<VideoKey, QImage> m_decoded{16 * 1024};
 
 public:
     ThumbnailImageProvider()
@@ -40,21 +49,54 @@ public:
     {
         if (!thumb.size() || key.isEmpty())
             return;
-        QMutexLocker locker(&m_mutex);
         auto img = QImage::fromData(thumb);
-        m_images[key] = std::move(img);
+        const VideoKey k = VideoKey::fromKey(key);
+        QMutexLocker locker(&m_mutex);
+        m_images[k] = std::move(img);
+    }
+
+    void insertRef(const QString &key, const QString &ref)
+    {
+        if (ref.isEmpty() || key.isEmpty())
+            return;
+        const VideoKey k = VideoKey::fromKey(key);
+        QMutexLocker locker(&m_mutex);
+        auto it = m_refs.find(k);
+        if (it != m_refs.end() && it.value() == ref)
+            return;
+        m_refs.insert(k, ref);
+        m_decoded.remove(k);
     }
 
     QImage requestImage(const QString &id,
                         QSize */*size*/,
                         const QSize &/*requestedSize*/) override
     {
-        QMutexLocker locker(&m_mutex);
+        const VideoKey k = VideoKey::fromKey(id, VideoKey::Lookup);
+        if (k.isNull())
+            return emptyImage;
+        QString ref;
+        {
+            QMutexLocker locker(&m_mutex);
+            auto it = m_images.constFind(k);
+            if (it != m_images.constEnd())
+                return it.value();
+            if (const QImage *img = m_decoded.object(k))
+                return *img;
+            ref = m_refs.value(k);
+        }
+        if (ref.isEmpty())
+            return emptyImage;
 
-        if (m_images.contains(id))
-            return m_images.value(id);
+        // Decode outside the lock, requests come from several QML loader threads
+        QImage img = QImage::fromData(ThumbnailStore::get(ref));
+        if (img.isNull())
+            return emptyImage;
 
-        return emptyImage;
+        QMutexLocker locker(&m_mutex);
+        if (m_refs.value(k) == ref)
+            m_decoded.insert(k, new QImage(img), qMax<qsizetype>(1, img.sizeInBytes() / 1024));
+        return img;
     }
 };
 
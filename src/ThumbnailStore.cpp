@@ -0,0 +1,220 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#include "ThumbnailStore.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QMutex>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QDebug>
+
+namespace {
+struct StoreLocation {
+    QMutex lock;
+    QString path;
+    bool fixed{false};
+};
+
+StoreLocation &storeLocation() {
+    static StoreLocation location;
+    return location;
+}
+
+// Refs of the blobs on disk, read once on first use so that contains() does not need to
+// stat. put() and collect() keep it up to date, under the same lock.
+struct BlobIndex {
+    QMutex lock;
+    QSet<QString> refs;
+    bool scanned{false};
+};
+
+BlobIndex &blobIndex() {
+    static BlobIndex index;
+    return index;
+}
+
+QMutex &blobLock() {
+    return blobIndex().lock;
+}
+
+bool isValidRef(const QString &ref) {
+    return ref.size() == 40; // hex SHA-1
+}
+
+QString ownersPath() {
+    return ThumbnailStore::location() + QStringLiteral("/owners");
+}
+} // namespace
+
+QString ThumbnailStore::location() {
+    StoreLocation &l = storeLocation();
+    QMutexLocker locker(&l.lock);
+    if (!l.fixed) {
+        l.path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/thumbnails";
+        l.fixed = true;
+    }
+    return l.path;
+}
+
+bool ThumbnailStore::setLocation(const QString &path) {
+    StoreLocation &l = storeLocation();
+    QMutexLocker locker(&l.lock);
+    if (l.fixed) {
+        qWarning() << "Thumbnail store already in use at " << l.path;
+        return false;
+    }
+    l.path = path;
+    l.fixed = true;
+    return true;
+}
+
+// Under blobLock()
+void ThumbnailStore::scan() {
+    BlobIndex &index = blobIndex();
+    if (index.scanned)
+        return;
+    QDirIterator blobs(location(), {QStringLiteral("*.png")}, QDir::Files, QDirIterator::Subdirectories);
+    while (blobs.hasNext()) {
+        blobs.next();
+        index.refs.insert(blobs.fileInfo().completeBaseName());
+    }
+    index.scanned = true;
+}
+
+QString ThumbnailStore::blobPath(const QString &ref) {
+    return location() + QLatin1Char('/') + ref.left(2) + QLatin1Char('/') + ref + ".png";
+}
+
+QString ThumbnailStore::put(const QByteArray &data) {
+    if (data.isEmpty())
+        return {};
+    const QString ref = QString::fromLatin1(
+        QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+    const QString path = blobPath(ref);
+    QMutexLocker locker(&blobLock());
+    QFile existing(path);
+    if (existing.open(QIODevice::ReadWrite | QIODevice::ExistingOnly)) {
+        // Referenced again, collect() must not take it before the owner publishes
+        existing.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+        blobIndex().refs.insert(ref);
+        return ref;
+    }
+
+    if (!QDir().mkpath(location() + QLatin1Char('/') + ref.left(2))) {
+        qWarning() << "Failed creating thumbnail store directory under " << location();
+        return {};
+    }
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed opening file " << path << " for writing.";
+        return {};
+    }
+    f.write(data);
+    if (!f.commit()) {
+        qWarning() << "Failed writing thumbnail " << path << " : " << f.errorString();
+        return {};
+    }
+    blobIndex().refs.insert(ref);
+    return ref;
+}
+
+QByteArray ThumbnailStore::get(const QString &ref) {
+    if (!isValidRef(ref))
+        return {};
+    QFile f(blobPath(ref));
+    if (!f.open(QIODevice::ReadOnly))
+        return {};
+    return f.readAll();
+}
+
+bool ThumbnailStore::contains(const QString &ref) {
+    if (!isValidRef(ref))
+        return false;
+    QMutexLocker locker(&blobLock());
+    scan();
+    return blobIndex().refs.contains(ref);
+}
+
+// One ref per line, replacing what owner published before
+bool ThumbnailStore::publish(const QString &owner, const QSet<QString> &refs) {
+    if (!QDir().mkpath(ownersPath())) {
+        qWarning() << "Failed creating thumbnail store directory under " << location();
+        return false;
+    }
+    const QByteArray ownerHash = QCryptographicHash::hash(owner.toUtf8(), QCryptographicHash::Sha1).toHex();
+    QSaveFile f(ownersPath() + QLatin1Char('/') + QString::fromLatin1(ownerHash) + ".refs");
+    if (!f.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed opening file " << f.fileName() << " for writing.";
+        return false;
+    }
+    QByteArray out;
+    out.reserve(refs.size() * 41);
+    for (const auto &ref : refs) {
+        if (isValidRef(ref))
+            out.append(ref.toLatin1()).append('\n');
+    }
+    f.write(out);
+    if (!f.commit()) {
+        qWarning() << "Failed writing " << f.fileName() << " : " << f.errorString();
+        return false;
+    }
+    return true;
+}
+
+// Returns how many blobs were removed. Nothing is, until some owner has published.
+int ThumbnailStore::collect(qint64 graceSecs) {
+    QSet<QString> live;
+    int owners = 0;
+    QDirIterator published(ownersPath(), {QStringLiteral("*.refs")}, QDir::Files);
+    while (published.hasNext()) {
+        QFile f(published.next());
+        if (!f.open(QIODevice::ReadOnly)) {
+            qWarning() << "Failed opening file " << f.fileName() << " for reading.";
+            return 0; // an incomplete view would remove blobs still in use
+        }
+        for (const QByteArray &line : f.readAll().split('\n')) {
+            if (line.size() == 40)
+                live.insert(QString::fromLatin1(line));
+        }
+        ++owners;
+    }
+    if (!owners)
+        return 0;
+
+    const QDateTime before = QDateTime::currentDateTimeUtc().addSecs(-graceSecs);
+    int removed = 0;
+    QDirIterator blobs(location(), {QStringLiteral("*.png")}, QDir::Files, QDirIterator::Subdirectories);
+    while (blobs.hasNext()) {
+        const QString path = blobs.next();
+        if (live.contains(blobs.fileInfo().completeBaseName()))
+            continue;
+        QMutexLocker locker(&blobLock());
+        if (QFileInfo(path).lastModified() > before) // stat again, put() may just have touched it
+            continue;
+        if (QFile::remove(path)) {
+            blobIndex().refs.remove(blobs.fileInfo().completeBaseName());
+            ++removed;
+        }
+    }
+    return removed;
+}
@@ -0,0 +1,50 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#ifndef THUMBNAILSTORE_H
+#define THUMBNAILSTORE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QSet>
+
+// Content-addressed blob store for video thumbnails, shared by every model and root.
+// A blob is stored once under <location>/<first 2 hex digits>/<sha1>.png and records
+// refer to it by its SHA-1, so identical thumbnails are written and kept only once.
+// Blobs nothing refers to any more are removed by collect(): every root publishes the
+// refs it holds under <location>/owners, and a blob in none of these sets goes once it is
+// older than the grace period. Roots not opened since they last published keep that set.
+// All functions are safe to call from worker threads.
+class ThumbnailStore
+{
+public:
+    static QString location(); // fixed from the first call on
+    static bool setLocation(const QString &path); // before any other use, e.g. in tests
+
+    static QString put(const QByteArray &data);
+    static QByteArray get(const QString &ref);
+    static bool contains(const QString &ref); // from memory, the store is listed once
+
+    static bool publish(const QString &owner, const QSet<QString> &refs);
+    static int collect(qint64 graceSecs = 7 * 24 * 3600);
+
+private:
+    static QString blobPath(const QString &ref);
+    static void scan();
+};
+
+#endif // THUMBNAILSTORE_H
@@ -0,0 +1,151 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+#include "TrigramIndex.h"
+
+#include <algorithm>
+#include <iterator>
+
+bool TrigramIndex::insert(int doc, const QString &text) {
+    if (doc < 0)
+        return false;
+    const QString folded = text.toCaseFolded();
+    if (doc >= m_texts.size())
+        m_texts.resize(doc + 1);
+    QString &current = m_texts[doc];
+    if (!current.isNull()) {
+        if (current == folded)
+            return false; // most updates do not touch the text
+        unpost(doc, current);
+        --m_count;
+    }
+    current = folded.isNull() ? QStringLiteral("") : folded; // null marks absent documents
+    post(doc, current);
+    ++m_count;
+    return true;
+}
+
+void TrigramIndex::remove(int doc) {
+    if (doc < 0 || doc >= m_texts.size() || m_texts.at(doc).isNull())
+        return;
+    unpost(doc, m_texts.at(doc));
+    m_texts[doc] = QString();
+    --m_count;
+}
+
+void TrigramIndex::clear() {
+    m_postings.clear();
+    m_texts.clear();
+    m_count = 0;
+}
+
+// Terms shorter than a trigram have no postings to narrow on, every text is compared
+QList<int> TrigramIndex::find(const QString &term) const {
+    const QString folded = term.toCaseFolded();
+    QList<int> res;
+    if (folded.isEmpty())
+        return res;
+    const auto grams = trigrams(folded);
+    if (grams.isEmpty()) {
+        for (int doc = 0; doc < m_texts.size(); ++doc) {
+            const QString &t = m_texts.at(doc);
+            if (!t.isNull() && t.contains(folded))
+                res.append(doc);
+        }
+        return res;
+    }
+
+    QList<const QList<int> *> lists;
+    lists.reserve(grams.size());
+    for (quint64 g : grams) {
+        auto it = m_postings.constFind(g);
+        if (it == m_postings.constEnd())
+            return res;
+        lists.append(&it.value());
+    }
+    std::sort(lists.begin(), lists.end(), [](const QList<int> *a, const QList<int> *b) {
+        return a->size() < b->size();
+    });
+    QList<int> candidates = *lists.first();
+    for (qsizetype i = 1; i < lists.size() && !candidates.isEmpty(); ++i) {
+        QList<int> narrowed;
+        std::set_intersection(candidates.cbegin(), candidates.cend(),
+                              lists.at(i)->cbegin(), lists.at(i)->cend(),
+                              std::back_inserter(narrowed));
+        candidates.swap(narrowed);
+    }
+    // All the trigrams being there does not mean they are adjacent
+    for (int doc : std::as_const(candidates)) {
+        if (m_texts.at(doc).contains(folded))
+            res.append(doc);
+    }
+    return res;
+}
+
+// For a term that extends an earlier one: its matches are among the earlier matches, so
+// those are compared directly, without the postings
+QList<int> TrigramIndex::narrow(const QString &term, const QList<int> &docs) const {
+    const QString folded = term.toCaseFolded();
+    QList<int> res;
+    for (int doc : docs) {
+        if (doc >= 0 && doc < m_texts.size() && !m_texts.at(doc).isNull() && m_texts.at(doc).contains(folded))
+            res.append(doc);
+    }
+    return res;
+}
+
+QList<quint64> TrigramIndex::trigrams(const QString &folded) {
+    QList<quint64> res;
+    if (folded.size() < 3)
+        return res;
+    res.reserve(folded.size() - 2);
+    for (qsizetype i = 0; i + 2 < folded.size(); ++i) {
+        res.append(quint64(folded.at(i).unicode()) << 32
+                   | quint64(folded.at(i + 1).unicode()) << 16
+                   | quint64(folded.at(i + 2).unicode()));
+    }
+    std::sort(res.begin(), res.end());
+    res.erase(std::unique(res.begin(), res.end()), res.end());
+    return res;
+}
+
+void TrigramIndex::post(int doc, const QString &folded) {
+    const auto grams = trigrams(folded);
+    for (quint64 g : grams) {
+        QList<int> &docs = m_postings[g];
+        if (docs.isEmpty() || docs.last() < doc) { // the common case when building
+            docs.append(doc);
+            continue;
+        }
+        auto it = std::lower_bound(docs.begin(), docs.end(), doc);
+        if (*it != doc)
+            docs.insert(it, doc);
+    }
+}
+
+void TrigramIndex::unpost(int doc, const QString &folded) {
+    const auto grams = trigrams(folded);
+    for (quint64 g : grams) {
+        auto p = m_postings.find(g);
+        if (p == m_postings.end())
+            continue;
+        auto it = std::lower_bound(p->begin(), p->end(), doc);
+        if (it != p->end() && *it == doc)
+            p->erase(it);
+        if (p->isEmpty())
+            m_postings.erase(p);
+    }
+}
@@ -0,0 +1,50 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+#ifndef TRIGRAMINDEX_H
+#define TRIGRAMINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+// Substring search over a set of short texts, such as titles. Every text is split in
+// overlapping three character sequences, and each of them lists the documents containing it.
+// A query takes the documents listed under all the trigrams of the term, smallest list
+// first, and only those are compared with the term. Matching is case insensitive.
+// Documents are small non negative integers, like MetadataTable row ids.
+class TrigramIndex
+{
+public:
+    bool insert(int doc, const QString &text); // replaces the text of doc, false if unchanged
+    void remove(int doc);
+    void clear();
+    qsizetype size() const { return m_count; }
+
+    QList<int> find(const QString &term) const; // ascending
+    QList<int> narrow(const QString &term, const QList<int> &docs) const; // the docs that match
+
+private:
+    static QList<quint64> trigrams(const QString &folded); // sorted, without duplicates
+    void post(int doc, const QString &folded);
+    void unpost(int doc, const QString &folded);
+
+    QHash<quint64, QList<int>> m_postings; // trigram -> ascending documents
+    QList<QString> m_texts; // case folded, by document; null when absent
+    qsizetype m_count{0};
+};
+
+#endif // TRIGRAMINDEX_H
@@ -0,0 +1,190 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#include "VideoKey.h"
+
+#include <QHash>
+#include <QStringList>
+#include <QReadWriteLock>
+
+namespace {
+constexpr int idLength = 11;
+
+// base64url digit value, or -1
+int digit(QChar c) {
+    const char16_t u = c.unicode();
+    if (u >= 'A' && u <= 'Z')
+        return u - 'A';
+    if (u >= 'a' && u <= 'z')
+        return u - 'a' + 26;
+    if (u >= '0' && u <= '9')
+        return u - '0' + 52;
+    if (u == '-')
+        return 62;
+    if (u == '_')
+        return 63;
+    return -1;
+}
+
+QChar symbol(int d) {
+    static constexpr char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    return QLatin1Char(alphabet[d]);
+}
+
+bool pack(QStringView id, quint64 &bits) {
+    if (id.size() != idLength)
+        return false;
+    quint64 res = 0;
+    for (int i = 0; i < idLength - 1; ++i) {
+        const int d = digit(id.at(i));
+        if (d < 0)
+            return false;
+        res = (res << 6) | quint64(d);
+    }
+    const int last = digit(id.at(idLength - 1));
+    if (last < 0 || (last & 3))
+        return false;
+    bits = (res << 4) | quint64(last >> 2);
+    return true;
+}
+
+// Shared by every model and by the loader threads
+struct InternTable {
+    QReadWriteLock lock;
+    QStringList strings;
+    QHash<QString, quint64> index;
+
+    // -1 when absent and not inserting
+    qint64 intern(QStringView s, bool insert) {
+        const QString str = s.toString();
+        {
+            QReadLocker locker(&lock);
+            auto it = index.constFind(str);
+            if (it != index.constEnd())
+                return qint64(it.value());
+        }
+        if (!insert)
+            return -1;
+        QWriteLocker locker(&lock);
+        auto it = index.constFind(str);
+        if (it != index.constEnd())
+            return qint64(it.value());
+        const quint64 i = quint64(strings.size());
+        strings.append(str);
+        index.insert(str, i);
+        return qint64(i);
+    }
+
+    QString at(quint64 i) {
+        QReadLocker locker(&lock);
+        return strings.value(qsizetype(i));
+    }
+};
+
+InternTable &internTable() {
+    static InternTable table;
+    return table;
+}
+} // namespace
+
+VideoKey VideoKey::interned(QStringView s, quint8 tag, Interning mode) {
+    const qint64 i = internTable().intern(s, mode == Intern);
+    if (i < 0)
+        return {};
+    return VideoKey(quint64(i), tag);
+}
+
+VideoKey VideoKey::make(Platform::Vendor vendor, bool shorts, QStringView id, Interning mode) {
+    const quint8 tag = quint8(vendor) | (shorts ? ShortsTag : 0);
+    quint64 bits = 0;
+    if (pack(id, bits))
+        return VideoKey(bits, tag);
+    return interned(id, tag | InternedId, mode);
+}
+
+VideoKey VideoKey::fromBits(quint64 bits, quint8 tag) {
+    const VideoKey res(bits, tag);
+    return res.isPersistent() ? res : VideoKey();
+}
+
+VideoKey VideoKey::fromKey(QStringView key, Interning mode) {
+    if (key.isEmpty())
+        return {};
+    const QStringView suffix = QStringView(videoExtension);
+    if (key.size() > suffix.size() + 1 && key.endsWith(suffix) && key.at(key.size() - suffix.size() - 1) == u'.')
+        key.chop(suffix.size() + 1);
+
+    // <vendor:3><type:1>_<id>
+    if (key.size() > 5 && key.at(4) == u'_' && key.startsWith(u"YTB")
+            && (key.at(3) == u'v' || key.at(3) == u's')) {
+        return make(Platform::YTB, key.at(3) == u's', key.sliced(5), mode);
+    }
+    return interned(key, RawKey, mode);
+}
+
+VideoKey VideoKey::fromUrl(QStringView url, Interning mode) {
+    if (url.startsWith(u"https://"))
+        url = url.sliced(8);
+    else if (url.startsWith(u"http://"))
+        url = url.sliced(7);
+    if (url.startsWith(u"www."))
+        url = url.sliced(4);
+    if (!url.startsWith(u"youtube.com/"))
+        return {};
+    url = url.sliced(12);
+
+    bool shorts = false;
+    if (url.startsWith(u"watch?v=")) {
+        url = url.sliced(8);
+    } else if (url.startsWith(u"shorts/")) {
+        url = url.sliced(7);
+        shorts = true;
+    } else {
+        return {};
+    }
+    qsizetype end = 0;
+    while (end < url.size() && url.at(end) != u'&' && url.at(end) != u'?' && url.at(end) != u'#')
+        ++end;
+    if (!end)
+        return {};
+    return make(Platform::YTB, shorts, url.first(end), mode);
+}
+
+QString VideoKey::toString() const {
+    if (isNull())
+        return {};
+    if (m_tag & RawKey)
+        return internTable().at(m_bits);
+
+    QString res = Platform::toString(vendor());
+    res.append(isShorts() ? u's' : u'v');
+    res.append(u'_');
+    if (m_tag & InternedId) {
+        res.append(internTable().at(m_bits));
+        return res;
+    }
+    QChar id[idLength];
+    id[idLength - 1] = symbol(int(m_bits & 0xf) << 2);
+    quint64 bits = m_bits >> 4;
+    for (int i = idLength - 2; i >= 0; --i) {
+        id[i] = symbol(int(bits & 0x3f));
+        bits >>= 6;
+    }
+    res.append(id, idLength);
+    return res;
+}
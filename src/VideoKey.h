@@ -0,0 +1,84 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+
+#ifndef VIDEOKEY_H
+#define VIDEOKEY_H
+
+#include "Platform.h"
+
+#include <QString>
+#include <QStringView>
+#include <QHashFunctions>
+
+// Integer form of a video key such as "YTBv_dQw4w9WgXcQ".
+// A YouTube ID is 11 base64url characters, and the last one only takes 16 values
+// (it carries 4 bits), so the ID packs into exactly 64 bits. Vendor and type
+// live in a separate tag byte. IDs that don't fit this shape, and keys that don't
+// parse at all, are interned in a process-wide table and referred to by index.
+// Parsing works on QStringView and allocates nothing for regular keys.
+class VideoKey
+{
+public:
+    // Lookup only parses, and yields a null key for an irregular key that was never interned.
+    // It is meant for queries, so they don't grow the intern table.
+    enum Interning { Intern, Lookup };
+
+    VideoKey() = default;
+
+    // "YTBv_<id>", optionally with the .yayc suffix
+    static VideoKey fromKey(QStringView key, Interning mode = Intern);
+    // youtube.com watch and shorts URLs
+    static VideoKey fromUrl(QStringView url, Interning mode = Intern);
+
+    // Inverse of bits()/tag(), for keys read back from disk. Only valid for persistent keys.
+    static VideoKey fromBits(quint64 bits, quint8 tag);
+
+    bool isNull() const { return !m_tag; }
+    // Interned keys index a process-local table, only regular keys can be stored as bits()/tag()
+    bool isPersistent() const { return m_tag && !(m_tag & (InternedId | RawKey)); }
+    Platform::Vendor vendor() const { return Platform::Vendor(m_tag & VendorMask); }
+    bool isShorts() const { return m_tag & ShortsTag; }
+    QString toString() const;
+
+    quint64 bits() const { return m_bits; }
+    quint8 tag() const { return m_tag; }
+
+    friend bool operator==(const VideoKey &a, const VideoKey &b) {
+        return a.m_bits == b.m_bits && a.m_tag == b.m_tag;
+    }
+    friend bool operator!=(const VideoKey &a, const VideoKey &b) { return !(a == b); }
+    friend size_t qHash(const VideoKey &k, size_t seed = 0) {
+        return qHashMulti(seed, k.m_bits, k.m_tag);
+    }
+
+private:
+    enum Tag : quint8 {
+        VendorMask  = 0x0f,
+        ShortsTag   = 0x10,
+        InternedId  = 0x20, // m_bits indexes the intern table, which holds the ID
+        RawKey      = 0x40, // m_bits indexes the intern table, which holds the whole key
+    };
+
+    VideoKey(quint64 bits, quint8 tag) : m_bits(bits), m_tag(tag) {}
+    static VideoKey make(Platform::Vendor vendor, bool shorts, QStringView id, Interning mode);
+    static VideoKey interned(QStringView s, quint8 tag, Interning mode);
+
+    quint64 m_bits{0};
+    quint8 m_tag{0};
+};
+
+#endif // VIDEOKEY_H
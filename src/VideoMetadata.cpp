@@ -16,23 +16,43 @@ In addition to the above,
 */
 
 #include "VideoMetadata.h"
+#include "ThumbnailStore.h"
 
 #include <QFile>
+#include <QSaveFile>
 #include <QFileInfo>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QCborStreamWriter>
+#include <QCborStreamReader>
+#include <QTimeZone>
 #include <QImage>
 #include <QBuffer>
 
-VideoMetadata::~VideoMetadata() {
-    if (!erased)
-        saveFile();
+namespace {
+// Keys of the CBOR record map. Append only, readers skip keys they don't know.
+enum CborField : quint64 {
+    VersionField = 0,
+    TitleField,
+    DurationField,
+    PositionField,
+    ViewedField,
+    ChannelField,
+    StarredField,
+    CreationDateField, // msecs since epoch, UTC
+    ThumbnailRefField,
+    ThumbnailField, // raw bytes, only when the ThumbnailStore could not take them
+    AccessDateField // msecs since epoch, UTC
+};
 }
 
 VideoMetadata::VideoMetadata() : vendor(Platform::UNK) {}
 
 VideoMetadata::VideoMetadata(const QString &k, const QDir &p)
-    : key(k), parent(p) {
+    : VideoMetadata(k, CategoryTable::intern(p.absolutePath())) {}
+
+VideoMetadata::VideoMetadata(const QString &k, CategoryTable::Id c)
+    : key(k), category(c) {
     vendor = Platform::toVendor(videoVendor(key));
     creationDate = QDateTime::currentDateTimeUtc();
 }
@@ -41,7 +61,7 @@ void VideoMetadata::setDuration(qreal d) {
     if (d == duration)
         return;
     duration = d;
-    dirty = true;
+    markDirty();
 }
 
 void VideoMetadata::setPosition(qreal p) {
@@ -54,7 +74,7 @@ void VideoMetadata::setPosition(qreal p) {
         return;
 
     position = p;
-    dirty = true;
+    markDirty();
     const auto threshold = duration * 0.9;
 
     if (duration > 3. && position > threshold && oldPosition <= threshold) {
@@ -67,21 +87,21 @@ void VideoMetadata::setViewed(bool v) {
     if (viewed == v)
         return;
     viewed = v;
-    dirty = true;
+    markDirty();
 }
 
 void VideoMetadata::setStarred(bool s) {
     if (starred == s)
         return;
     starred = s;
-    dirty = true;
+    markDirty();
 }
 
 bool VideoMetadata::setTitle(const QString &t) {
     if (title == t)
         return false;
     title = t;
-    dirty = true;
+    markDirty();
     return true;
 }
 
@@ -89,7 +109,7 @@ bool VideoMetadata::setChannelID(const QString &cid) {
     if (channelID == cid)
         return false;
     channelID = cid;
-    dirty = true;
+    markDirty();
     return true;
 }
 
@@ -110,24 +130,40 @@ bool VideoMetadata::update(const QString &t, qreal p, qreal d) {
     return res;
 }
 
+// Hour granularity: the archive cutoff is in days, and replaying a video does not need to
+// rewrite its record every few seconds
+bool VideoMetadata::setAccessDate(const QDateTime &t) {
+    if (accessDate.isValid() && accessDate.secsTo(t) < 3600)
+        return false;
+    accessDate = t;
+    markDirty();
+    return true;
+}
+
 bool VideoMetadata::moveLocation(const QDir &d) {
-    if (parent == d)
+    const CategoryTable::Id target = CategoryTable::intern(d.absolutePath());
+    if (target == category)
         return true;
     const QString oldName = filePath();
-    parent = d;
+    category = target;
     const QString newName = filePath();
+    if (journaled) { // the category is part of the journal record
+        if (QFile::exists(oldName)) // placeholder left by an older version
+            QFile::rename(oldName, newName);
+        markDirty();
+        return true;
+    }
     QFile f(oldName);
     auto res = f.rename(newName);
-    if (!res) {
+    if (!res)
         qWarning() << "Error moving " << oldName << " to " << newName << " : " << f.errorString();
-    }
     return res;
 }
 
 bool VideoMetadata::eraseFile() {
     QFile f(filePath());
     erased = true;
-    return f.remove();
+    return f.remove() || journaled; // journaled records have no file, unless an old placeholder
 }
 
 void VideoMetadata::setThumbnail(const QByteArray &ba) {
@@ -148,19 +184,24 @@ void VideoMetadata::setThumbnail(const QByteArray &ba) {
     buffer.open(QIODevice::WriteOnly);
     image.save(&buffer, "PNG", 0);
 
-    thumbnailData = out;
-    dirty = true;
+    thumbnailRef = ThumbnailStore::put(out);
+    thumbnailData = thumbnailRef.isEmpty() ? out : QByteArray();
+    markDirty();
 }
 
-const QByteArray &VideoMetadata::thumbnail() const {
-    return thumbnailData;
+QByteArray VideoMetadata::thumbnail() const {
+    if (thumbnailData.size() || thumbnailRef.isEmpty())
+        return thumbnailData;
+    return ThumbnailStore::get(thumbnailRef);
 }
 
-void VideoMetadata::saveFile() {
-    if (!dirty)
-        return;
-    dirty = false;
+bool VideoMetadata::thumbnailAvailable() const {
+    return thumbnailData.size() || ThumbnailStore::contains(thumbnailRef);
+}
 
+// Records only reference their thumbnail in the ThumbnailStore. It is embedded as base64
+// for self-contained exports, or if the store could not be written.
+QVariantMap VideoMetadata::toVariantMap(bool embedThumbnail) const {
     QVariantMap m;
     m["title"] = title;
     m["duration"] = duration;
@@ -169,35 +210,16 @@ void VideoMetadata::saveFile() {
     m["channel"] = channelID;
     m["starred"] = starred;
     m["creationDate"] = creationDate;
-    if (thumbnailData.size())
-        m["thumbnail"] = QString::fromLatin1(thumbnailData.toBase64());
-
-    QJsonDocument d = QJsonDocument::fromVariant(m);
-    QFile f(filePath());
-
-    if (!f.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
-        qWarning() << "Failed opening file "<<f.fileName()<< " for writing.";
-        return;
-    }
-    f.write(d.toJson());
-    f.close();
+    if (accessDate.isValid())
+        m["accessDate"] = accessDate;
+    if (!thumbnailRef.isEmpty() && !embedThumbnail)
+        m["thumbnailRef"] = thumbnailRef;
+    else if (hasThumbnail())
+        m["thumbnail"] = QString::fromLatin1(thumbnail().toBase64());
+    return m;
 }
 
-void VideoMetadata::loadFile() {
-    QFile f(filePath());
-    if (!f.exists())
-        return;
-    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qWarning() << "Failed opening file " << f.fileName()<< " for reading.";
-        return;
-    }
-    QString data = f.readAll();
-    f.close();
-
-    QJsonDocument d = QJsonDocument::fromJson(data.toUtf8());
-    QVariant v = d.toVariant();
-    QVariantMap m = v.toMap();
-
+void VideoMetadata::fromVariantMap(const QVariantMap &m) {
     title = m.value("title").toString();
     position = m.value("position").toReal();
     duration = m.value("duration").toReal();
@@ -212,20 +234,210 @@ void VideoMetadata::loadFile() {
     if (m.contains("channel")) {
         channelID = m.value("channel").toString();
     }
-    if (m.contains("thumbnail")) {
-        thumbnailData = QByteArray::fromBase64(m.value("thumbnail").toString().toLatin1());
+    // Only the reference is kept, the blob is read when the image is first shown.
+    // A dangling reference (root copied from another machine) shows up as
+    // !thumbnailAvailable() and is refetched by fetchMissingThumbnails().
+    if (m.contains("thumbnailRef")) {
+        thumbnailRef = m.value("thumbnailRef").toString();
+    } else if (m.contains("thumbnail")) {
+        // Legacy inline thumbnail: moved into the store now, the record drops it on next save
+        const QByteArray data = QByteArray::fromBase64(m.value("thumbnail").toString().toLatin1());
+        thumbnailRef = ThumbnailStore::put(data);
+        if (thumbnailRef.isEmpty())
+            thumbnailData = data;
     }
     if (m.contains("creationDate") && m.value("creationDate").toDateTime().isValid()) {
         creationDate = m.value("creationDate").toDateTime();
     } else {
+        creationDate = QDateTime(); // let the caller pick a fallback
+    }
+    accessDate = m.value("accessDate").toDateTime();
+    dirty = false;
+}
+
+void VideoMetadata::markDirty() {
+    dirty = true;
+}
+
+QByteArray VideoMetadata::toJson() const {
+    return QJsonDocument::fromVariant(toVariantMap()).toJson();
+}
+
+// Same thumbnail rules as toVariantMap()
+QByteArray VideoMetadata::toCbor(bool embedThumbnail) const {
+    const bool hasDate = creationDate.isValid();
+    const bool hasAccess = accessDate.isValid();
+    const bool hasRef = !thumbnailRef.isEmpty() && !embedThumbnail;
+    const QByteArray data = hasRef ? QByteArray() : thumbnail();
+    const bool hasData = data.size();
+
+    QByteArray out;
+    QCborStreamWriter w(&out);
+    w.append(QCborKnownTags::Signature);
+    w.startMap(7 + hasDate + hasAccess + hasRef + hasData);
+    w.append(quint64(VersionField));
+    w.append(RecordFormat::cborVersion);
+    w.append(quint64(TitleField));
+    w.append(title);
+    w.append(quint64(DurationField));
+    w.append(double(duration));
+    w.append(quint64(PositionField));
+    w.append(double(position));
+    w.append(quint64(ViewedField));
+    w.append(viewed);
+    w.append(quint64(ChannelField));
+    w.append(channelID);
+    w.append(quint64(StarredField));
+    w.append(starred);
+    if (hasDate) {
+        w.append(quint64(CreationDateField));
+        w.append(creationDate.toMSecsSinceEpoch());
+    }
+    if (hasRef) {
+        w.append(quint64(ThumbnailRefField));
+        w.append(thumbnailRef);
+    }
+    if (hasData) {
+        w.append(quint64(ThumbnailField));
+        w.append(data);
+    }
+    if (hasAccess) {
+        w.append(quint64(AccessDateField));
+        w.append(accessDate.toMSecsSinceEpoch());
+    }
+    w.endMap();
+    return out;
+}
+
+// Counterpart of fromVariantMap() for the CBOR encoding
+bool VideoMetadata::fromCbor(const QByteArray &data) {
+    QCborStreamReader r(data);
+    if (r.isTag() && r.toTag() == QCborTag(QCborKnownTags::Signature))
+        r.next();
+    if (!r.isMap() || !r.enterContainer())
+        return false;
+
+    bool hasViewed = false;
+    QByteArray inlineThumbnail;
+    creationDate = QDateTime(); // let the caller pick a fallback
+    accessDate = QDateTime();
+    while (r.hasNext() && r.lastError() == QCborError::NoError) {
+        switch (RecordFormat::readInteger(r)) {
+        case VersionField:
+            if (quint64(RecordFormat::readInteger(r)) > RecordFormat::cborVersion) {
+                qWarning() << "Unsupported record version in " << filePath();
+                return false;
+            }
+            break;
+        case TitleField:
+            title = RecordFormat::readString(r);
+            break;
+        case DurationField:
+            duration = RecordFormat::readDouble(r);
+            break;
+        case PositionField:
+            position = RecordFormat::readDouble(r);
+            break;
+        case ViewedField:
+            viewed = RecordFormat::readBool(r);
+            hasViewed = true;
+            break;
+        case ChannelField:
+            channelID = RecordFormat::readString(r);
+            break;
+        case StarredField:
+            starred = RecordFormat::readBool(r);
+            break;
+        case CreationDateField:
+            creationDate = QDateTime::fromMSecsSinceEpoch(RecordFormat::readInteger(r), QTimeZone::UTC);
+            break;
+        case ThumbnailRefField:
+            thumbnailRef = RecordFormat::readString(r);
+            break;
+        case ThumbnailField:
+            inlineThumbnail = RecordFormat::readBytes(r);
+            break;
+        case AccessDateField:
+            accessDate = QDateTime::fromMSecsSinceEpoch(RecordFormat::readInteger(r), QTimeZone::UTC);
+            break;
+        default:
+            r.next();
+            break;
+        }
+    }
+    if (r.lastError() != QCborError::NoError || !r.leaveContainer())
+        return false;
+
+    if (!hasViewed && duration > 0. && position > duration * 0.9)
+        viewed = true;
+    if (thumbnailRef.isEmpty() && inlineThumbnail.size()) {
+        thumbnailRef = ThumbnailStore::put(inlineThumbnail);
+        if (thumbnailRef.isEmpty())
+            thumbnailData = inlineThumbnail;
+    }
+    dirty = false;
+    return true;
+}
+
+QByteArray VideoMetadata::serialize(RecordFormat::Format format) const {
+    return (format == RecordFormat::Cbor) ? toCbor() : toJson();
+}
+
+// Synchronous write, for use outside of a model. Models queue serialize() on their MetadataWriter.
+void VideoMetadata::saveFile(RecordFormat::Format format) {
+    if (!dirty || journaled)
+        return;
+    dirty = false;
+
+    QSaveFile f(filePath());
+    const QIODevice::OpenMode mode = (format == RecordFormat::Cbor)
+                                         ? QIODevice::WriteOnly
+                                         : QIODevice::WriteOnly | QIODevice::Text;
+    if (!f.open(mode)) {
+        qWarning() << "Failed opening file " << f.fileName() << " for writing.";
+        return;
+    }
+    f.write(serialize(format));
+    if (!f.commit())
+        qWarning() << "Failed writing " << f.fileName() << " : " << f.errorString();
+}
+
+bool VideoMetadata::loadFile() {
+    QFile f(filePath());
+    if (!f.exists())
+        return false;
+    if (!f.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed opening file " << f.fileName()<< " for reading.";
+        return false;
+    }
+    const QByteArray data = f.readAll();
+    f.close();
+
+    // Either encoding may be found, whatever the root's format, see RecordFormat
+    bool ok = true;
+    if (RecordFormat::isCbor(data)) {
+        ok = fromCbor(data);
+    } else {
+        QJsonParseError error;
+        const QJsonDocument doc = QJsonDocument::fromJson(data, &error);
+        ok = error.error == QJsonParseError::NoError && doc.isObject();
+        if (ok)
+            fromVariantMap(doc.toVariant().toMap());
+    }
+    if (!ok)
+        qWarning() << "Failed decoding " << f.fileName();
+
+    if (!creationDate.isValid()) {
         QFileInfo check_file(f);
         creationDate = check_file.birthTime().toUTC();
     }
-    dirty = false;
+    if (!accessDate.isValid()) // older records: the last write is the last time it was opened
+        accessDate = QFileInfo(f).lastModified().toUTC();
+    return ok;
 }
 
 QString VideoMetadata::filePath() const {
-    return parent.absoluteFilePath(key + "." + videoExtension);
+    return CategoryTable::filePath(category, key, videoExtension);
 }
 
 QUrl VideoMetadata::url(bool startingTime) const {
@@ -19,34 +19,41 @@ In addition to the above,
 #define VIDEOMETADATA_H
 
 #include "Platform.h"
+#include "CategoryTable.h"
+#include "RecordFormat.h"
 
 #include <QString>
 #include <QDir>
 #include <QUrl>
 #include <QByteArray>
 #include <QDateTime>
+#include <QVariantMap>
 
 struct VideoMetadata
 {
     QString key;
     Platform::Vendor vendor;
-    QDir parent;
+    CategoryTable::Id category{0}; // containing directory
     QString title;
     QString channelID;
     qreal duration{.0};
     qreal position{.0};
     bool viewed{false};
     bool starred{false};
-    QByteArray thumbnailData;
+    QByteArray thumbnailData; // only kept when the ThumbnailStore could not take it
+    QString thumbnailRef; // ThumbnailStore key, the image itself is read on demand
     QDateTime creationDate;
+    QDateTime accessDate; // last opened, history only. Decides when a record goes to the HistoryArchive
     bool erased{false};
     bool dirty{false};
+    bool journaled{false}; // content lives in the root journal, there is no file
 
-    ~VideoMetadata();
     VideoMetadata();
     VideoMetadata(const QString &k, const QDir &p);
+    VideoMetadata(const QString &k, CategoryTable::Id c);
 
-    bool hasThumbnail() const { return thumbnailData.size(); }
+    bool hasThumbnail() const { return !thumbnailRef.isEmpty() || thumbnailData.size(); }
+    bool thumbnailAvailable() const; // hasThumbnail() and the blob is actually there
 
     void setDuration(qreal d);
     void setPosition(qreal p);
@@ -55,13 +62,23 @@ struct VideoMetadata
     bool setTitle(const QString &t);
     bool setChannelID(const QString &cid);
     bool update(const QString &t, qreal p = 0., qreal d = 0.);
+    bool setAccessDate(const QDateTime &t);
     bool moveLocation(const QDir &d);
     bool eraseFile();
     void setThumbnail(const QByteArray &ba);
-    const QByteArray &thumbnail() const;
-    void saveFile();
-    void loadFile();
+    QByteArray thumbnail() const;
+    QVariantMap toVariantMap(bool embedThumbnail = false) const;
+    void fromVariantMap(const QVariantMap &m);
+    void markDirty();
+    QByteArray toJson() const;
+    QByteArray toCbor(bool embedThumbnail = false) const;
+    bool fromCbor(const QByteArray &data);
+    QByteArray serialize(RecordFormat::Format format) const;
+    void saveFile(RecordFormat::Format format = RecordFormat::Json);
+    bool loadFile(); // false if missing, unreadable or undecodable
     QString filePath() const;
+    QString parentPath() const { return CategoryTable::path(category); }
+    void setParent(const QDir &d) { category = CategoryTable::intern(d.absolutePath()); }
     QUrl url(bool startingTime = true) const;
 };
 
@@ -0,0 +1,168 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+#include "WorkingDirIndex.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSet>
+
+WorkingDirIndex::WorkingDirIndex(QObject *parent) : QObject(parent) {
+    m_debounce.setSingleShot(true);
+    m_debounce.setInterval(500);
+    connect(&m_debounce, &QTimer::timeout, this, &WorkingDirIndex::update);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &WorkingDirIndex::directoryChanged);
+}
+
+void WorkingDirIndex::setRoot(const QString &root) {
+    const QString cleaned = root.isEmpty() ? QString() : QDir::cleanPath(root);
+    if (cleaned == m_root)
+        return;
+    m_root = cleaned;
+    scan();
+}
+
+void WorkingDirIndex::refresh(const QString &root, const QString &key) {
+    if (m_root.isEmpty() || QDir::cleanPath(root) != m_root || key.isEmpty())
+        return;
+    reprobe(key);
+}
+
+// Same test as QDir::isEmpty() for NonEmpty, the summary may be anywhere below the folder
+quint8 WorkingDirIndex::probe(const QString &dir) {
+    if (!QFileInfo(dir).isDir())
+        return 0;
+    quint8 s = Exists;
+    QDirIterator entries(dir, QDir::AllEntries | QDir::NoDotAndDotDot);
+    if (!entries.hasNext())
+        return s;
+    s |= NonEmpty;
+    QDirIterator summaries(dir, QStringList() << "*summary*", QDir::Files, QDirIterator::Subdirectories);
+    if (summaries.hasNext())
+        s |= HasSummary;
+    return s;
+}
+
+void WorkingDirIndex::scan() {
+    m_debounce.stop();
+    m_states.clear();
+    m_watched.clear();
+    m_unwatched.clear();
+    m_stale.clear();
+    m_listingChanged = false;
+    const QStringList watched = m_watcher.directories();
+    if (!watched.isEmpty())
+        m_watcher.removePaths(watched);
+    if (m_root.isEmpty() || !QFileInfo(m_root).isDir())
+        return;
+    m_watcher.addPath(m_root);
+    QDirIterator it(m_root, QDir::Dirs | QDir::NoDotAndDotDot);
+    while (it.hasNext()) {
+        it.next();
+        m_states.insert(it.fileName(), probe(it.filePath()));
+        watch(it.fileName());
+    }
+}
+
+// Subfolders are watched too, as the summary may be written anywhere below the folder
+void WorkingDirIndex::watch(const QString &key) {
+    const QString dir = m_root + QLatin1Char('/') + key;
+    QStringList paths{dir};
+    QDirIterator it(dir, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext())
+        paths.append(it.next());
+    const QStringList failed = m_watcher.addPaths(paths);
+    if (!failed.isEmpty()) {
+        m_unwatched.insert(key, QFileInfo(dir).lastModified());
+        for (const QString &path : failed)
+            paths.removeOne(path);
+    }
+    if (!paths.isEmpty())
+        m_watched.insert(key, paths);
+}
+
+void WorkingDirIndex::unwatch(const QString &key) {
+    const QStringList paths = m_watched.take(key);
+    if (!paths.isEmpty())
+        m_watcher.removePaths(paths);
+    m_unwatched.remove(key);
+}
+
+bool WorkingDirIndex::reprobe(const QString &key) {
+    const quint8 before = m_states.value(key);
+    const quint8 s = probe(m_root + QLatin1Char('/') + key);
+    unwatch(key); // subfolders may have come or gone
+    if (!s) {
+        m_states.remove(key);
+        return before;
+    }
+    m_states.insert(key, s);
+    watch(key);
+    return s != before;
+}
+
+void WorkingDirIndex::directoryChanged(const QString &path) {
+    const QString cleaned = QDir::cleanPath(path);
+    if (cleaned == m_root)
+        m_listingChanged = true;
+    else if (cleaned.startsWith(m_root + QLatin1Char('/')))
+        m_stale.insert(cleaned.mid(m_root.size() + 1).section(QLatin1Char('/'), 0, 0));
+    else
+        return;
+    m_debounce.start();
+}
+
+// The listing of the root is compared only when the root changed; known folders are probed
+// again when the watcher reported them, or, for unwatched ones, when their mtime moved
+void WorkingDirIndex::update() {
+    QStringList changedKeys;
+    if (m_listingChanged) {
+        QSet<QString> present;
+        QDirIterator it(m_root, QDir::Dirs | QDir::NoDotAndDotDot);
+        while (it.hasNext()) {
+            it.next();
+            const QString key = it.fileName();
+            present.insert(key);
+            if (!m_states.contains(key)) {
+                m_states.insert(key, probe(it.filePath()));
+                watch(key);
+                changedKeys.append(key);
+            }
+        }
+        for (auto i = m_states.begin(); i != m_states.end();) {
+            if (present.contains(i.key())) {
+                ++i;
+                continue;
+            }
+            changedKeys.append(i.key());
+            unwatch(i.key());
+            i = m_states.erase(i);
+        }
+        for (auto i = m_unwatched.cbegin(); i != m_unwatched.cend(); ++i) {
+            if (QFileInfo(m_root + QLatin1Char('/') + i.key()).lastModified() != i.value())
+                m_stale.insert(i.key());
+        }
+    }
+    for (const QString &key : std::as_const(m_stale)) {
+        if (m_states.contains(key) && !changedKeys.contains(key) && reprobe(key))
+            changedKeys.append(key);
+    }
+    m_stale.clear();
+    m_listingChanged = false;
+    if (!changedKeys.isEmpty())
+        emit changed(changedKeys);
+}
@@ -0,0 +1,79 @@
+/*
+Copyright (C) 2023- YAYC team <info@yayc.stream>
+
+This work is licensed under the terms of the Creative Commons Attribution-NonCommercial-ShareAlike 4.0 International License.
+To view a copy of this license, visit https://creativecommons.org/licenses/by-nc-sa/4.0/ or send a letter to Creative Commons, PO Box 1866, Mountain View, CA 94042, USA.
+
+In addition to the above,
+- The use of this work for training, fine-tuning, or otherwise feeding artificial intelligence systems is prohibited for both commercial and non-commercial use.
+  This includes, but is not limited to, the ingestion of this work into large language models (LLMs), code generation models,
+  Retrieval-Augmented Generation (RAG) systems, embedding databases, vector stores, or any other AI-assisted system.
+- Any and all donation options in derivative work must be the same as in the original work.
+- All use of this work outside of the above terms must be explicitly agreed upon in advance with the exclusive copyright owner(s).
+- Any derivative work must retain the above copyright and acknowledge that any and all use of the derivative work outside the above terms
+  must be explicitly agreed upon in advance with the exclusive copyright owner(s) of the original work.
+
+*/
+#ifndef WORKINGDIRINDEX_H
+#define WORKINGDIRINDEX_H
+
+#include <QDateTime>
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+// What is stored on disk for each video, under the working directory root of the external
+// app: whether the per-video folder exists, whether it has anything in it, and whether that
+// includes a summary. Filled by one walk of the root and then kept current, so that the
+// saved/unsaved filter and the row icons never hit the disk. The root is watched for folders
+// appearing or going away, and each folder with its subfolders for files coming and going in
+// it. A folder the watcher refused (inotify limits) is probed again whenever its mtime moved.
+// refresh() still lets whoever makes a change (the external app queue, storage deletion) see
+// it before the watcher fires.
+class WorkingDirIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum State : quint8 {
+        Exists = 0x1,
+        NonEmpty = 0x2,
+        HasSummary = 0x4
+    };
+
+    explicit WorkingDirIndex(QObject *parent = nullptr);
+
+    void setRoot(const QString &root); // rescans, unless root is the current one
+    QString root() const { return m_root; }
+    quint8 state(const QString &key) const { return m_states.value(key); }
+    const QHash<QString, quint8> &states() const { return m_states; }
+    void refresh(const QString &root, const QString &key); // ignored for another root
+
+    static quint8 probe(const QString &dir);
+
+signals:
+    void changed(const QStringList &keys); // folders whose state changed from outside
+
+private:
+    void scan();
+    void update();
+    void directoryChanged(const QString &path);
+    void watch(const QString &key);
+    void unwatch(const QString &key);
+    bool reprobe(const QString &key); // true if the state changed
+
+    QString m_root;
+    QHash<QString, quint8> m_states; // folder name -> State flags, only existing folders
+    QHash<QString, QStringList> m_watched; // folder name -> watched paths, itself first
+    QHash<QString, QDateTime> m_unwatched; // folder name -> mtime, when the watcher refused it
+    QSet<QString> m_stale; // folders whose content changed since the last update()
+    bool m_listingChanged = false;
+    QFileSystemWatcher m_watcher;
+    QTimer m_debounce;
+};
+
+#endif // WORKINGDIRINDEX_H
@@ -17,6 +17,7 @@ In addition to the above,
 
 #include "YaycUtilities.h"
 #include "Platform.h"
+#include "VideoKey.h"
 #include "ThumbnailFetcher.h"
 #include "RequestInterceptor.h"
 
@@ -172,19 +173,8 @@ QString YaycUtilities::getVideoID(QUrl url) const
         qWarning() << "Unknown Video platform for :" << url;
         return {};
     }
-    if (vendor == Platform::YTB) {
-        if (isYoutubeStandardUrl(surl)) {
-            const QStringView stripped = QStringView{surl}.mid(standardVideoPattern.size());
-            const int idx = stripped.indexOf('&');
-            return "YTBv_" + stripped.mid(0, idx).toString();
-        } else if (isYoutubeShortsUrl(surl)) {
-            const QStringView stripped = QStringView{surl}.mid(shortsVideoPattern.size());
-            const int idx = stripped.indexOf('?');
-            return "YTBs_" + stripped.mid(0, idx).toString();
-        } else {
-            return {};
-        }
-    }
+    if (vendor == Platform::YTB)
+        return VideoKey::fromUrl(surl).toString(); // null for anything but watch and shorts URLs
     qWarning() << "getVideoID error: "<<url;
     return {};
 }
@@ -401,9 +391,7 @@ void YaycUtilities::setColorScheme(bool darkMode)
 
 bool YaycUtilities::isShortVideo(const QString &fkey)
 {
-    if (!fkey.size())
-        return false;
-    return videoType(fkey) == QLatin1String("s_");
+    return fkey.size() > 4 && fkey.at(3) == u's' && fkey.at(4) == u'_';
 }
 
 void YaycUtilities::openInBrowser(const QString &key, const QString &extWorkingDirRoot)
@@ -28,6 +28,7 @@ In addition to the above,
 #include "KeyInterceptor.h"
 #include "qqmlsettings.h"
 #include "YaycContext.h"
+#include "RecordFormat.h"
 
 #include <QGuiApplication>
 #include <QApplication>
@@ -83,11 +84,52 @@ int main(int argc, char *argv[])
             parser.addVersionOption();
             parser.addOption({{"d", "debug"}, "Enable debug mode"});
             parser.addOption({{"c", "config"}, "Configuration file path", "file"});
+            parser.addOption({"convert-records",
+                              "Rewrite the records of the given roots as json or cbor, then exit",
+                              "format"});
+            parser.addPositionalArgument("roots", "Root directories for --convert-records", "[roots...]");
             parser.process(helpApp); // exits for help/version
             return 0;
         }
     }
 
+    // Headless record conversion, no GUI or WebEngine needed
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--convert-records", 17) == 0) {
+            QCoreApplication::setOrganizationName("YAYC"); // ThumbnailStore location
+            QCoreApplication::setApplicationName("yayc");
+            QCoreApplication toolApp(argc, argv);
+            QCommandLineParser parser;
+            QCommandLineOption convertOption("convert-records", "Target format", "format");
+            parser.addOption(convertOption);
+            parser.addPositionalArgument("roots", "Root directories", "[roots...]");
+            parser.process(toolApp);
+
+            const QString format = parser.value(convertOption);
+            if (format != QLatin1String("json") && format != QLatin1String("cbor")) {
+                qWarning() << "Unknown record format " << format << ", use json or cbor";
+                return 1;
+            }
+            int res = 0;
+            const auto roots = parser.positionalArguments();
+            for (const auto &root : roots) {
+                int skipped = 0;
+                const int converted = RecordFormat::migrate(QDir(root),
+                    (format == QLatin1String("cbor")) ? RecordFormat::Cbor : RecordFormat::Json, &skipped);
+                if (converted < 0) {
+                    res = 1;
+                    continue;
+                }
+                qInfo() << root << ": " << converted << " records converted";
+                if (skipped) {
+                    qWarning() << root << ": " << skipped << " unreadable records left unconverted";
+                    res = 1;
+                }
+            }
+            return res;
+        }
+    }
+
     // Must be set before ANY Qt initialization
     // Workaround for Qt 6.10.x accessibility crash (QTBUG-...)
     qputenv("QT_ACCESSIBILITY", "0");
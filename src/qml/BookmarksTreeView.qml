@@ -50,6 +50,10 @@ Rectangle {
     property bool showFiltering: false
     property bool searchInTitles: true
     property bool searchInChannelNames: true
+    property bool rankedResults: false // best matches as a flat list instead of the tree
+    property string appliedSearchTerm: ""
+    readonly property bool showRanked: rankedResults && showFiltering && appliedSearchTerm !== ""
+    property var archivedMatches: [] // history only, see FileSystemModel::searchArchive()
     property bool historyView
     property var model: (historyView === undefined) ? undefined
                             : ((historyView) ?
@@ -90,8 +94,17 @@ Rectangle {
         extCommandEnabled: viewContainer.extCommandEnabled
     }
 
-    onSearchInTitlesChanged: if (model) model.sortFilterProxyModel.searchInTitles = viewContainer.searchInTitles
-    onSearchInChannelNamesChanged: if (model) model.sortFilterProxyModel.searchInChannelNames = viewContainer.searchInChannelNames
+    onSearchInTitlesChanged: {
+        if (!model) return
+        model.sortFilterProxyModel.searchInTitles = viewContainer.searchInTitles
+        viewContainer.searchLists()
+    }
+    onSearchInChannelNamesChanged: {
+        if (!model) return
+        model.sortFilterProxyModel.searchInChannelNames = viewContainer.searchInChannelNames
+        viewContainer.searchLists()
+    }
+    onRankedResultsChanged: if (model) viewContainer.searchLists()
 
     onSearchInSavedChanged: {
         if (!model) return
@@ -141,9 +154,21 @@ Rectangle {
 
     function search() {
         viewContainer.model.sortFilterProxyModel.searchTerm = filterTF.text
+        viewContainer.appliedSearchTerm = filterTF.text
+        viewContainer.searchLists()
         forceLayoutTimer.restart()
     }
 
+    // The ranked list and the archived history matches, which the tree does not show
+    function searchLists() {
+        const term = viewContainer.appliedSearchTerm
+        if (viewContainer.rankedResults && term !== "")
+            viewContainer.model.rankedSearch(term, viewContainer.searchInTitles, viewContainer.searchInChannelNames)
+        viewContainer.archivedMatches = (viewContainer.historyView && term !== "")
+                ? viewContainer.model.searchArchive(term)
+                : []
+    }
+
     function refreshLayout() {
         forceLayoutTimer.restart()
     }
@@ -308,6 +333,32 @@ Rectangle {
                                 ToolTip.delay: 300
                             }
                         }
+                        Image {
+                            id: filterButtonRanked
+                            source:  "/icons/featured_play_list.svg"
+                            height: filterTF.height * 0.3
+                            width: height
+                            layer.enabled: true
+                            layer.mipmap: true
+                            layer.effect: ColorOverlay {
+                                color: (viewContainer.rankedResults) ? YaycProperties.checkedButtonColor : YaycProperties.iconColor
+                                visible: true
+                            }
+                            MouseArea {
+                                anchors.fill: parent
+                                onClicked: (mouse) => {
+                                    viewContainer.rankedResults = !viewContainer.rankedResults
+                                }
+
+                                property bool hovered: false
+                                onEntered:  hovered = true
+                                onExited: hovered = false
+                                hoverEnabled: true
+                                ToolTip.visible: hovered
+                                ToolTip.text: uiTr("Click to") + " " + ((viewContainer.rankedResults) ? uiTr("disable") : uiTr("enable")) + " " + uiTr("best matches first, typos allowed")
+                                ToolTip.delay: 300
+                            }
+                        }
                     }
                 }
             }
@@ -560,6 +611,7 @@ Rectangle {
         clip: true
         reuseItems: false
         boundsBehavior: Flickable.StopAtBounds
+        visible: !viewContainer.showRanked
 
         anchors {
             left: parent.left
@@ -567,7 +619,7 @@ Rectangle {
             top: (viewContainer.showFiltering)
                  ? filterContainer.bottom
                  : parent.top
-            bottom: parent.bottom
+            bottom: archivedBar.top
         }
 
         model: (viewContainer.model !== null && viewContainer.model !== undefined)
@@ -915,9 +967,119 @@ Rectangle {
         } // Delegate Root (Rectangle)
     } // QC1.TreeView
 
+    // Flat list of FileSystemModel::rankedSearch() results, in place of the tree
+    ListView {
+        id: rankedView
+        clip: true
+        visible: viewContainer.showRanked
+        boundsBehavior: Flickable.StopAtBounds
+        anchors.fill: view
+        model: (viewContainer.showRanked && viewContainer.model)
+               ? viewContainer.model.searchResults : null
+        ScrollBar.vertical: ScrollBar {}
+
+        delegate: Rectangle {
+            id: rankedDelegate
+            required property string key
+            required property string title
+            required property string channelName
+            required property bool starred
+            width: rankedView.width
+            height: viewContainer._rowHeight
+            color: YaycProperties.fileBgColor
+            border.color: (rankedMA.containsMouse) ? "green" : "transparent"
+            border.width: 2
+
+            Row {
+                anchors.fill: parent
+                anchors.leftMargin: viewContainer._branchIndicatorSize
+                spacing: 6
+                Image {
+                    visible: rankedDelegate.starred
+                    anchors.verticalCenter: parent.verticalCenter
+                    source: "qrc:/images/starred.png"
+                    fillMode: Image.PreserveAspectFit
+                    height: parent.height * 0.8
+                }
+                Text {
+                    anchors.verticalCenter: parent.verticalCenter
+                    width: parent.width - x
+                    text: rankedDelegate.title
+                          + ((rankedDelegate.channelName !== "") ? "  -- " + rankedDelegate.channelName : "")
+                    elide: Text.ElideRight
+                    color: YaycProperties.textColor
+                    renderType: Text.QtRendering
+                    font {
+                        pixelSize: YaycProperties.fsP1
+                        family: mainFont.name
+                    }
+                }
+            }
+            MouseArea {
+                id: rankedMA
+                anchors.fill: parent
+                hoverEnabled: true
+                cursorShape: Qt.PointingHandCursor
+                onClicked: viewContainer.videoSelected(viewContainer.model.videoUrl(rankedDelegate.key))
+            }
+        }
+    }
+
+    // History entries moved to the archive that match the search. Picking one brings it
+    // back into the history and opens it.
+    Rectangle {
+        id: archivedBar
+        visible: viewContainer.archivedMatches.length > 0
+        height: (visible) ? viewContainer._rowHeight : 0
+        color: YaycProperties.categoryBgColor
+        anchors {
+            left: parent.left
+            right: parent.right
+            bottom: parent.bottom
+        }
+
+        Text {
+            anchors.fill: parent
+            anchors.leftMargin: viewContainer._branchIndicatorSize
+            verticalAlignment: Text.AlignVCenter
+            text: uiTr("Archived matches") + ": " + viewContainer.archivedMatches.length
+            elide: Text.ElideRight
+            color: YaycProperties.textColor
+            font {
+                pixelSize: YaycProperties.fsP1
+                family: mainFont.name
+            }
+        }
+        MouseArea {
+            anchors.fill: parent
+            cursorShape: Qt.PointingHandCursor
+            onClicked: archivedMenu.popup()
+        }
+
+        Menu {
+            id: archivedMenu
+            Instantiator {
+                model: viewContainer.archivedMatches
+                delegate: MenuItem {
+                    required property var modelData
+                    text: modelData.title
+                          + ((modelData.channelName !== "") ? "  -- " + modelData.channelName : "")
+                    onTriggered: {
+                        if (!viewContainer.model.restoreArchived(modelData.key))
+                            return
+                        viewContainer.videoSelected(viewContainer.model.videoUrl(modelData.key))
+                        viewContainer.searchLists()
+                    }
+                }
+                onObjectAdded: (index, object) => archivedMenu.insertItem(index, object)
+                onObjectRemoved: (index, object) => archivedMenu.removeItem(object)
+            }
+        }
+    }
+
     Rectangle {
         id: scrollBar // touch-friendly scrollbar
-        visible: scrollHandle.height < view.height - 1
+        visible: view.visible && scrollHandle.height < view.height - 1
         color: YaycProperties.iconColor
         opacity: 0.2
         anchors {
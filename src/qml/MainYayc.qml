@@ -169,6 +169,7 @@ Item {
     property bool showCategoryBar: true
     property int homeGridColumns: 4
     property int maxRecentDestinations: 5
+    property int historyHotDays: 90 // 0 keeps the whole history loaded
     property var recentDestinationPaths: []
     property real wevZoomFactor
     property real wevZoomFactorVideo
@@ -202,6 +203,7 @@ Item {
 
     Binding { target: YaycProperties; property: "isDarkMode"; value: root.darkMode }
     Binding { target: fileSystemModel; property: "maxRecentDestinations"; value: root.maxRecentDestinations }
+    Binding { target: historyModel; property: "hotDays"; value: root.historyHotDays }
     // Recent destinations live in the model, which is recreated on every setRoot(): the binding
     // pushes the persisted list into whichever model is current, the Connections below stores
     // back what the model adds.
@@ -264,6 +266,7 @@ Item {
         property alias showCategoryBar: root.showCategoryBar
         property alias homeGridColumns: root.homeGridColumns
         property alias maxRecentDestinations: root.maxRecentDestinations
+        property alias historyHotDays: root.historyHotDays
         property alias recentDestinationPaths: root.recentDestinationPaths
         property alias volume: root.volume
         property alias userSpecifiedVolume: root.userSpecifiedVolume
@@ -1162,10 +1165,43 @@ Item {
         onOpenHelpDialog: helpContainer.visible = true
         onOpenProxyDialog: proxyMenu.open()
         onOpenCustomScriptDialog: customScriptDialog.open()
+        onOpenLibraryExport: libraryExportDialog.open()
+        onOpenLibraryImport: libraryImportDialog.open()
         onClearSettingsRequested: utilities.clearSettings(configFileUrl)
         onQuitRequested: root.quit()
     }
 
+    // Whole bookmarks library as one file, written and read on a worker
+    QQD.FileDialog {
+        id: libraryExportDialog
+        title: uiTr("Export bookmarks")
+        fileMode: QQD.FileDialog.SaveFile
+        defaultSuffix: "ndjson"
+        nameFilters: [uiTr("Bookmarks") + " (*.ndjson *.cbor)"]
+        onAccepted: fileSystemModel.exportLibrary(root.deUrlizePath(String(selectedFile)))
+    }
+    QQD.FileDialog {
+        id: libraryImportDialog
+        title: uiTr("Import bookmarks")
+        fileMode: QQD.FileDialog.OpenFile
+        nameFilters: [uiTr("Bookmarks") + " (*.ndjson *.cbor)"]
+        onAccepted: fileSystemModel.importLibrary(root.deUrlizePath(String(selectedFile)))
+    }
+    QQD.MessageDialog {
+        id: libraryTransferDialog
+        title: uiTr("Bookmarks")
+        buttons: QQD.MessageDialog.Ok
+    }
+    Connections {
+        target: fileSystemModel
+        function onLibraryTransferFinished(success, count, error) {
+            libraryTransferDialog.text = (success)
+                    ? uiTr("Bookmarks transferred") + ": " + count
+                    : uiTr("Bookmarks transfer failed") + ": " + error
+            libraryTransferDialog.open()
+        }
+    }
+
     PathEditDialog {
         id: bookmarksEditDialog
         dialogTitle: uiTr("Bookmarks directory")
@@ -36,6 +36,8 @@ Popup {
     signal openHelpDialog()
     signal openProxyDialog()
     signal openCustomScriptDialog()
+    signal openLibraryExport()
+    signal openLibraryImport()
     signal clearSettingsRequested()
     signal quitRequested()
 
@@ -445,6 +447,41 @@ Popup {
                     }
                     onActivated: if (smenu.host) smenu.host.removeStorageOnDelete = !smenu.host.removeStorageOnDelete
                 }
+                ColumnLayout {
+                    Layout.fillWidth: true
+                    Layout.leftMargin: 12
+                    Layout.rightMargin: 12
+                    Layout.topMargin: 6
+                    Layout.bottomMargin: 6
+                    spacing: 2
+                    RowLayout {
+                        Layout.fillWidth: true
+                        Label {
+                            text: uiTr("Archive history after (days)")
+                            color: YaycProperties.textColor
+                            font.pixelSize: YaycProperties.fsH4
+                            Layout.fillWidth: true
+                        }
+                        Label {
+                            text: hotDaysSlider.value > 0 ? hotDaysSlider.value : uiTr("Never")
+                            color: YaycProperties.disabledTextColor
+                            font.pixelSize: YaycProperties.fsP1
+                        }
+                    }
+                    Slider {
+                        id: hotDaysSlider
+                        Layout.fillWidth: true
+                        from: 0; to: 365; stepSize: 15
+                        snapMode: Slider.SnapAlways
+                        value: smenu.host ? smenu.host.historyHotDays : 90
+                        onMoved: if (smenu.host) smenu.host.historyHotDays = value
+                        ToolTip {
+                            parent: hotDaysSlider.handle
+                            visible: hotDaysSlider.hovered || hotDaysSlider.pressed
+                            text: uiTr("History entries not opened for this long are moved to a compressed archive, and are no longer loaded at startup")
+                        }
+                    }
+                }
                 MenuRow {
                     label: uiTr("Blank when invisible")
                     iconSource: "/icons/exit_to_app.svg"
@@ -483,6 +520,35 @@ Popup {
                     onActivated: { smenu.openProxyDialog(); smenu.close() }
                 }
                 MenuDivider {}
+                MenuRow {
+                    label: uiTr("Export bookmarks")
+                    iconSource: "/icons/download_for_offline.svg"
+                    chevron: true
+                    rowEnabled: !fileSystemModel.libraryTransferRunning
+                    rowTooltip: uiTr("Write all bookmarks, categories and channels to a single file (.ndjson, or .cbor)")
+                    onActivated: { smenu.openLibraryExport(); smenu.close() }
+                }
+                MenuRow {
+                    label: uiTr("Import bookmarks")
+                    iconSource: "/icons/playlist_add.svg"
+                    chevron: true
+                    rowEnabled: !fileSystemModel.libraryTransferRunning
+                    rowTooltip: uiTr("Add the bookmarks of an exported file. Existing bookmarks are kept")
+                    onActivated: { smenu.openLibraryImport(); smenu.close() }
+                }
+                MenuRow {
+                    label: uiTr("Unsaved changes")
+                    iconSource: "/icons/hard_drive_outline.svg"
+                    rowTooltip: uiTr("Edited bookmarks not saved yet, and writes waiting for the disk. Click to save now")
+                    rightItem: Label {
+                        anchors.verticalCenter: parent.verticalCenter
+                        text: fileSystemModel.unsavedChanges + " / " + fileSystemModel.pendingWrites
+                        color: YaycProperties.disabledTextColor
+                        font.pixelSize: YaycProperties.fsP1
+                    }
+                    onActivated: fileSystemModel.sync()
+                }
+                MenuDivider {}
                 MenuRow {
                     label: uiTr("Clear settings")
                     iconSource: "/icons/delete_forever.svg"
@@ -1,15 +1,74 @@
 #include <QtTest>
 #include "YaycUtilities.h"
+#include "MetadataJournal.h"
+#include "CacheSnapshot.h"
+#include "MetadataWriter.h"
+#include "VideoKey.h"
+#include "FileSystemModel.h"
+#include "ThumbnailStore.h"
+#include "PositionLog.h"
+#include "LibraryStream.h"
+#include "HistoryArchive.h"
+#include "CategoryTree.h"
+#include "WorkingDirIndex.h"
+#include "TrigramIndex.h"
+#include "FuzzyIndex.h"
+#include "ThumbnailImageProvider.h"
+
+#include <QQmlApplicationEngine>
 
 class TestYayc : public QObject
 {
     Q_OBJECT
 
 private slots:
+    void initTestCase();
     void compareSemver_data();
     void compareSemver();
+    void journalReplay();
+    void writerCoalescing();
+    void cacheSnapshot();
+    void dirtySync();
+    void positionLogReplay();
+    void videoKey_data();
+    void videoKey();
+    void categoryRename();
+    void recordMigration();
+    void libraryStream_data();
+    void libraryStream();
+    void historyArchive();
+    void thumbnailStore();
+    void categoryTree();
+    void workingDirIndex();
+    void directoryChanges();
+    void asyncFilter();
+    void rowNotifications();
+    void channelRename();
+    void trigramIndex();
+    void fuzzyIndex();
+    void cacheRootBenchmark_data();
+    void cacheRootBenchmark();
+    void libraryStreamBenchmark_data();
+    void libraryStreamBenchmark();
+    void scrollBenchmark_data();
+    void scrollBenchmark();
+
+private:
+    void createBenchLibrary();
+
+    QTemporaryDir m_thumbnails;
+    QTemporaryDir m_benchRoot;
+    int m_benchEntries{0};
 };
 
+// Snapshots, settings and thumbnails stay out of the user's directories
+void TestYayc::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(m_thumbnails.isValid());
+    QVERIFY(ThumbnailStore::setLocation(m_thumbnails.path()));
+}
+
 void TestYayc::compareSemver_data()
 {
     QTest::addColumn<QString>("v1");
@@ -39,5 +98,958 @@ void TestYayc::compareSemver()
     QCOMPARE(utils.compareSemver(v1, v2), expected);
 }
 
+void TestYayc::journalReplay()
+{
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+    QDir root(tmp.path());
+    QVERIFY(root.mkpath("music/live"));
+
+    {
+        MetadataJournal journal(root);
+        VideoMetadata a("YTBv_aaaaaaaaaaa", root);
+        a.title = "first";
+        journal.append(a);
+        a.title = "second";
+        a.setParent(QDir(root.filePath("music/live")));
+        journal.append(a);
+        VideoMetadata b("YTBs_bbbbbbbbbbb", root);
+        journal.append(b);
+        journal.erase(b.key);
+    }
+    QVERIFY(MetadataJournal::exists(root));
+
+    QHash<QString, VideoMetadata> videos;
+    QHash<QString, ChannelMetadata> channels;
+    MetadataJournal journal(root);
+    journal.load(videos, channels);
+    QCOMPARE(videos.size(), 1);
+    QCOMPARE(videos.value("YTBv_aaaaaaaaaaa").title, QString("second"));
+    QCOMPARE(videos.value("YTBv_aaaaaaaaaaa").parentPath(),
+             QDir(root.filePath("music/live")).absolutePath());
+    QVERIFY(videos.value("YTBv_aaaaaaaaaaa").journaled);
+    QVERIFY(!videos.contains("YTBs_bbbbbbbbbbb"));
+}
+
+void TestYayc::writerCoalescing()
+{
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+    const QString replaced = QDir(tmp.path()).filePath("replaced");
+    const QString appended = QDir(tmp.path()).filePath("appended");
+
+    MetadataWriter writer;
+    for (int i = 0; i < 100; ++i)
+        writer.replace(replaced, QByteArray::number(i));
+    writer.append(replaced, "+tail");
+    writer.append(appended, "a");
+    writer.append(appended, "b");
+    writer.waitForDone();
+    QCOMPARE(writer.queueDepth(), 0);
+
+    QFile r(replaced);
+    QVERIFY(r.open(QIODevice::ReadOnly));
+    QCOMPARE(r.readAll(), QByteArray("99+tail"));
+    QFile a(appended);
+    QVERIFY(a.open(QIODevice::ReadOnly));
+    QCOMPARE(a.readAll(), QByteArray("ab"));
+
+    // Whether or not the writer got to them first, nothing of a cancelled path lands later
+    QDir(tmp.path()).mkdir("category");
+    QStringList paths;
+    for (int i = 0; i < 50; ++i) {
+        paths.append(QDir(tmp.path()).filePath(QString("category/%1").arg(i)));
+        writer.replace(paths.last(), QByteArray(4096, 'x'));
+    }
+    const bool dropped = writer.cancel(paths.last());
+    const QStringList droppedUnder = writer.cancelUnder(QDir(tmp.path()).filePath("category"));
+    QVERIFY(!droppedUnder.contains(paths.last()));
+    const QDir category(tmp.path() + "/category");
+    const qsizetype written = category.entryList(QDir::Files).size(); // final already
+    writer.waitForDone();
+    QCOMPARE(QFile::exists(paths.last()), !dropped);
+    QCOMPARE(category.entryList(QDir::Files).size(), written);
+    QCOMPARE(written + droppedUnder.size() + int(dropped), paths.size());
+}
+
+// Only categories whose directory changed since the snapshot are read from disk again
+void TestYayc::cacheSnapshot()
+{
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+    const QDir root(tmp.path());
+    QVERIFY(root.mkpath("music"));
+    QVERIFY(root.mkpath("talks"));
+    VideoMetadata kept("YTBv_aaaaaaaaaaa", QDir(root.filePath("music")));
+    VideoMetadata reread("YTBv_bbbbbbbbbbb", QDir(root.filePath("talks")));
+    for (auto *v : {&kept, &reread}) {
+        v->title = "before";
+        v->dirty = true;
+        v->saveFile();
+    }
+    QTest::qWait(2100); // mtimes newer than that are not trusted by save()
+
+    CacheSnapshot snapshot(root);
+    QVERIFY(snapshot.save(cacheRoot(root), {}, false));
+
+    // Rewritten in place, which leaves the mtime of music alone: the snapshot wins there
+    QTemporaryDir scratch;
+    VideoMetadata edited(kept.key, QDir(scratch.path()));
+    edited.title = "after";
+    edited.dirty = true;
+    edited.saveFile();
+    QFile source(edited.filePath());
+    QVERIFY(source.open(QIODevice::ReadOnly));
+    QFile target(kept.filePath());
+    QVERIFY(target.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    target.write(source.readAll());
+    target.close();
+    // A new record in talks changes its mtime, so talks is read again
+    reread.title = "after";
+    reread.dirty = true;
+    reread.saveFile();
+    VideoMetadata added("YTBv_ccccccccccc", QDir(root.filePath("talks")));
+    added.title = "added";
+    added.dirty = true;
+    added.saveFile();
+
+    QHash<QString, VideoMetadata> videos;
+    QHash<QString, ChannelMetadata> channels;
+    QVERIFY(snapshot.load(videos, channels, false));
+    QCOMPARE(videos.size(), 3);
+    QCOMPARE(videos.value(kept.key).title, QString("before"));
+    QCOMPARE(videos.value(reread.key).title, QString("after"));
+    QCOMPARE(videos.value(added.key).title, QString("added"));
+    QVERIFY(!QFile::exists(snapshot.filePath())); // consumed
+    QVERIFY(!snapshot.load(videos, channels, false));
+}
+
+// sync() writes the records changed since the last one, and nothing else
+void TestYayc::dirtySync()
+{
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+    const QDir root(tmp.path());
+    QVERIFY(root.mkpath("music"));
+    const QStringList keys{"YTBv_aaaaaaaaaaa", "YTBv_bbbbbbbbbbb", "YTBv_ccccccccccc"};
+    QHash<QString, QDateTime> written;
+    for (const QString &key : keys) {
+        VideoMetadata v(key, QDir(root.filePath("music")));
+        v.title = key;
+        v.dirty = true;
+        v.saveFile();
+        written.insert(key, QFileInfo(v.filePath()).lastModified());
+    }
+
+    QQmlApplicationEngine engine;
+    engine.addImageProvider(QLatin1String("videothumbnail"), new ThumbnailImageProvider);
+    FileSystemModel *model = new FileSystemModel("dirtySyncModel", false, &engine);
+    model->setRoot(root.absolutePath());
+    QCOMPARE(model->unsavedChanges(), 0);
+
+    QTest::qWait(20); // so that a rewrite shows in the mtime
+    model->starEntry(keys.at(1), true);
+    QCOMPARE(model->unsavedChanges(), 1);
+    model->sync();
+    QCOMPARE(model->unsavedChanges(), 0);
+    QTRY_COMPARE(model->pendingWrites(), 0);
+
+    for (const QString &key : keys) {
+        const QFileInfo fi(VideoMetadata(key, QDir(root.filePath("music"))).filePath());
+        QCOMPARE(fi.lastModified() != written.value(key), key == keys.at(1));
+    }
+    VideoMetadata starred(keys.at(1), QDir(root.filePath("music")));
+    starred.loadFile();
+    QVERIFY(starred.starred);
+}
+
+void TestYayc::positionLogReplay()
+{
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+    QDir root(tmp.path());
+    const QString key("YTBv_aaaaaaaaaaa");
+
+    MetadataWriter writer;
+    {
+        PositionLog log(root, &writer);
+        log.record(VideoKey::fromKey(key), 10., 100.);
+        log.record(VideoKey::fromKey("YTBv_bbbbbbbbbbb"), 5., 50.);
+        log.record(VideoKey::fromKey(key), 95., 100.);
+        log.commit();
+        writer.waitForDone();
+    }
+    QFile f(root.filePath(positionLogFileName));
+    QCOMPARE(f.size(), qint64(3 * PositionLog::recordSize));
+    QVERIFY(f.open(QIODevice::Append));
+    f.write("torn");
+    f.close();
+
+    QHash<QString, VideoMetadata> videos;
+    videos.insert(key, VideoMetadata(key, root));
+    PositionLog log(root, &writer);
+    QCOMPARE(log.replay(videos), 1);
+    QCOMPARE(videos.value(key).position, 95.);
+    QCOMPARE(videos.value(key).duration, 100.);
+    QVERIFY(videos.value(key).viewed);
+    QVERIFY(videos.value(key).dirty);
+    QCOMPARE(QFileInfo(f.fileName()).size(), qint64(3 * PositionLog::recordSize)); // torn tail cut
+
+    // Appended after the cut, so it is read back on the next start
+    log.record(VideoKey::fromKey(key), 42., 100.);
+    log.commit();
+    writer.waitForDone();
+    QHash<QString, VideoMetadata> restarted;
+    restarted.insert(key, VideoMetadata(key, root));
+    QCOMPARE(PositionLog(root, &writer).replay(restarted), 1);
+    QCOMPARE(restarted.value(key).position, 42.);
+
+    log.checkpoint();
+    writer.waitForDone();
+    QCOMPARE(QFileInfo(f.fileName()).size(), qint64(0));
+}
+
+void TestYayc::videoKey_data()
+{
+    QTest::addColumn<QString>("key");
+    QTest::addColumn<bool>("shorts");
+
+    QTest::newRow("standard")       << "YTBv_dQw4w9WgXcQ" << false;
+    QTest::newRow("shorts")         << "YTBs_-_09azAZ-_8" << true;
+    QTest::newRow("all ones")       << "YTBv___________w" << false;
+    QTest::newRow("irregular id")   << "YTBv_notAnId"     << false;
+    QTest::newRow("unparseable")    << "somethingElse"    << false;
+}
+
+void TestYayc::videoKey()
+{
+    QFETCH(QString, key);
+    QFETCH(bool, shorts);
+
+    const VideoKey k = VideoKey::fromKey(key);
+    QVERIFY(!k.isNull());
+    QCOMPARE(k.isShorts(), shorts);
+    QCOMPARE(k.toString(), key);
+    QCOMPARE(VideoKey::fromKey(key + "." + videoExtension, VideoKey::Lookup), k);
+    QCOMPARE(qHash(VideoKey::fromKey(key)), qHash(k));
+    if (key.startsWith("YTB")) {
+        const QString url = (shorts ? shortsVideoPattern : standardVideoPattern) + key.mid(5);
+        QCOMPARE(VideoKey::fromUrl(url + (shorts ? "?feature=share" : "&t=42s")), k);
+    }
+    QVERIFY(VideoKey::fromKey(u"YTBv_neverSeenBefore", VideoKey::Lookup).isNull());
+}
+
+void TestYayc::categoryRename()
+{
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+    QDir root(tmp.path());
+
+    VideoMetadata top("YTBv_aaaaaaaaaaa", QDir(root.filePath("music")));
+    VideoMetadata nested("YTBv_bbbbbbbbbbb", QDir(root.filePath("music/live")));
+    VideoMetadata other("YTBv_ccccccccccc", QDir(root.filePath("musicals")));
+
+    const auto moved = CategoryTable::rename(root.filePath("music"), root.filePath("audio"));
+    QCOMPARE(moved.size(), 2);
+    QCOMPARE(top.filePath(), root.filePath("audio/YTBv_aaaaaaaaaaa.yayc"));
+    QCOMPARE(nested.filePath(), root.filePath("audio/live/YTBv_bbbbbbbbbbb.yayc"));
+    QCOMPARE(other.filePath(), root.filePath("musicals/YTBv_ccccccccccc.yayc"));
+    QCOMPARE(CategoryTable::intern(root.filePath("audio/live")), nested.category);
+}
+
+void TestYayc::recordMigration()
+{
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+    QDir root(tmp.path());
+    QVERIFY(root.mkpath("music"));
+
+    VideoMetadata v("YTBv_aaaaaaaaaaa", QDir(root.filePath("music")));
+    v.title = QString::fromUtf8("caf\xc3\xa9 live");
+    v.channelID = "@someone";
+    v.duration = 300.;
+    v.position = 290.5;
+    v.starred = true;
+    v.thumbnailRef = "0123456789abcdef0123456789abcdef01234567";
+    v.dirty = true;
+    v.saveFile();
+    QCOMPARE(RecordFormat::of(root), RecordFormat::Json);
+
+    QCOMPARE(RecordFormat::migrate(root, RecordFormat::Cbor), 1);
+    QCOMPARE(RecordFormat::of(root), RecordFormat::Cbor);
+    QFile f(v.filePath());
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    QVERIFY(RecordFormat::isCbor(f.readAll()));
+    QCOMPARE(RecordFormat::migrate(root, RecordFormat::Cbor), 0);
+
+    VideoMetadata loaded("YTBv_aaaaaaaaaaa", QDir(root.filePath("music")));
+    loaded.loadFile();
+    QCOMPARE(loaded.title, v.title);
+    QCOMPARE(loaded.channelID, v.channelID);
+    QCOMPARE(loaded.duration, v.duration);
+    QCOMPARE(loaded.position, v.position);
+    QCOMPARE(loaded.starred, v.starred);
+    QCOMPARE(loaded.viewed, v.viewed);
+    QCOMPARE(loaded.thumbnailRef, v.thumbnailRef);
+    QCOMPARE(loaded.creationDate.toMSecsSinceEpoch(), v.creationDate.toMSecsSinceEpoch());
+
+    QCOMPARE(RecordFormat::migrate(root, RecordFormat::Json), 1);
+    QCOMPARE(RecordFormat::of(root), RecordFormat::Json);
+    VideoMetadata back("YTBv_aaaaaaaaaaa", QDir(root.filePath("music")));
+    QVERIFY(back.loadFile());
+    QCOMPARE(back.title, v.title);
+    QCOMPARE(back.position, v.position);
+
+    // A record that does not decode is left alone, rather than replaced with an empty one
+    VideoMetadata corrupt("YTBv_bbbbbbbbbbb", QDir(root.filePath("music")));
+    const QByteArray garbage("{\"title\": \"trunc");
+    QFile broken(corrupt.filePath());
+    QVERIFY(broken.open(QIODevice::WriteOnly));
+    broken.write(garbage);
+    broken.close();
+    QVERIFY(!corrupt.loadFile());
+    int skipped = 0;
+    QCOMPARE(RecordFormat::migrate(root, RecordFormat::Cbor, &skipped), 1);
+    QCOMPARE(skipped, 1);
+    QVERIFY(broken.open(QIODevice::ReadOnly));
+    QCOMPARE(broken.readAll(), garbage);
+}
+
+void TestYayc::libraryStream_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::newRow("ndjson") << int(LibraryStream::Ndjson);
+    QTest::newRow("cbor")   << int(LibraryStream::Cbor);
+}
+
+void TestYayc::libraryStream()
+{
+    QFETCH(int, format);
+    QTemporaryDir source;
+    QTemporaryDir target;
+    QVERIFY(source.isValid() && target.isValid());
+    const QDir from(source.path());
+    const QDir to(target.path());
+
+    VideoMetadata v("YTBs_aaaaaaaaaaa", QDir(from.filePath("music/live")));
+    v.title = "title";
+    v.channelID = "@someone";
+    v.duration = 60.;
+    v.position = 30.;
+    v.thumbnailRef = "0123456789abcdef0123456789abcdef01234567";
+    ChannelMetadata c = ChannelMetadata::create("@someone", "Someone", Platform::YTB, from);
+    c.thumbnailData = QByteArray::fromHex("0001ff00");
+
+    QByteArray stream;
+    {
+        QBuffer out(&stream);
+        QVERIFY(out.open(QIODevice::WriteOnly));
+        LibraryWriter w(&out, LibraryStream::Format(format), from, false);
+        w.header(1, 1);
+        w.category(from.filePath("empty"));
+        w.video(v);
+        w.channel(c);
+    }
+
+    QBuffer in(&stream);
+    QVERIFY(in.open(QIODevice::ReadOnly));
+    LibraryReader r(&in, to);
+    auto item = r.next();
+    QCOMPARE(item.type, LibraryReader::Item::Header);
+    QCOMPARE(item.videos, qint64(1));
+    item = r.next();
+    QCOMPARE(item.type, LibraryReader::Item::Category);
+    QCOMPARE(item.category, to.filePath("empty"));
+    item = r.next();
+    QCOMPARE(item.type, LibraryReader::Item::Video);
+    QCOMPARE(item.video.key, v.key);
+    QCOMPARE(item.video.title, v.title);
+    QCOMPARE(item.video.position, v.position);
+    QCOMPARE(item.video.thumbnailRef, v.thumbnailRef);
+    QCOMPARE(item.video.filePath(), to.filePath("music/live/YTBs_aaaaaaaaaaa.yayc"));
+    item = r.next();
+    QCOMPARE(item.type, LibraryReader::Item::Channel);
+    QCOMPARE(item.channel.key(), c.key());
+    QCOMPARE(item.channel.thumbnailData, c.thumbnailData);
+    QCOMPARE(r.next().type, LibraryReader::Item::End);
+}
+
+// Synthetic library: YAYC_BENCH_ENTRIES (default 50000) entries spread over 50 categories,
+// each referencing a small thumbnail in the test ThumbnailStore. Only built when YAYC_BENCHMARK is set.
+void TestYayc::createBenchLibrary()
+{
+    if (!qEnvironmentVariableIsSet("YAYC_BENCHMARK") || m_benchEntries)
+        return;
+    m_benchEntries = qEnvironmentVariableIntValue("YAYC_BENCH_ENTRIES");
+    if (m_benchEntries <= 0)
+        m_benchEntries = 50000;
+
+    QDir root(m_benchRoot.path());
+    const QString thumbnailRef = ThumbnailStore::put(QByteArray(2048, 'x'));
+    for (int i = 0; i < m_benchEntries; ++i) {
+        const QString category = QString("category%1").arg(i % 50);
+        root.mkpath(category);
+        VideoMetadata v(QString("YTBv_%1").arg(i, 11, 10, QLatin1Char('0')),
+                        QDir(root.filePath(category)));
+        v.title = QString("Synthetic video number %1").arg(i);
+        v.channelID = QString("@channel%1").arg(i % 997);
+        v.duration = 600.;
+        v.position = i % 600;
+        v.thumbnailRef = thumbnailRef;
+        v.dirty = true;
+        v.saveFile();
+    }
+}
+
+void TestYayc::historyArchive()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QDir root(dir.path());
+    HistoryArchive archive(root);
+    const QString path = archive.filePath();
+
+    VideoMetadata a("YTBs_aaaaaaaaaaa", root);
+    a.title = "first";
+    a.position = 10.;
+    a.thumbnailRef = "0123456789abcdef0123456789abcdef01234567";
+    VideoMetadata b("YTBs_bbbbbbbbbbb", QDir(root.filePath("music")));
+    b.title = "second";
+    QVERIFY(HistoryArchive::appendSegment(path, root, {a, b}));
+    a.position = 20.; // archived again later, the newer segment wins
+    QVERIFY(HistoryArchive::appendSegment(path, root, {a}));
+    QCOMPARE(HistoryArchive::segmentCount(path), 2);
+
+    QVERIFY(HistoryArchive::rotate(path, root));
+    QCOMPARE(HistoryArchive::segmentCount(path), 1);
+
+    archive.readIndex(); // headers only
+    QVERIFY(!archive.isLoaded());
+    QVERIFY(archive.contains(a.key));
+    QVERIFY(archive.contains(b.key));
+    QCOMPARE(archive.thumbnailRefs(), QSet<QString>({a.thumbnailRef}));
+    VideoMetadata c("YTBs_ccccccccccc", root); // compacted before the first search
+    archive.insert(c);
+    QVERIFY(archive.contains(c.key));
+
+    archive.load();
+    QCOMPARE(archive.records().size(), 3);
+    QCOMPARE(archive.records().value(a.key).position, 20.);
+    QCOMPARE(archive.records().value(b.key).parentPath(), root.filePath("music"));
+    const VideoMetadata restored = archive.take(b.key);
+    QCOMPARE(restored.title, b.title);
+    QVERIFY(!archive.contains(b.key));
+
+    // Restored or deleted keys stay out of the archive, also after a restart and a rotation
+    QVERIFY(HistoryArchive::appendTombstones(path, {b.key}));
+    HistoryArchive restarted(root);
+    restarted.readIndex();
+    QVERIFY(!restarted.contains(b.key));
+    QVERIFY(restarted.contains(a.key));
+    restarted.load();
+    QVERIFY(!restarted.records().contains(b.key));
+    QCOMPARE(HistoryArchive::segmentCount(path), 2);
+    QVERIFY(HistoryArchive::rotate(path, root));
+    HistoryArchive rotated(root);
+    rotated.load();
+    QCOMPARE(rotated.records().size(), 1);
+    QVERIFY(rotated.records().contains(a.key));
+    QVERIFY(HistoryArchive::appendSegment(path, root, {b})); // archived again later
+    HistoryArchive rearchived(root);
+    rearchived.readIndex();
+    QVERIFY(rearchived.contains(b.key));
+    QVERIFY(rearchived.remove(b.key));
+    QVERIFY(!rearchived.remove(b.key));
+}
+
+void TestYayc::thumbnailStore()
+{
+    QVERIFY(!ThumbnailStore::setLocation(QDir::tempPath())); // in use already
+    QCOMPARE(ThumbnailStore::location(), m_thumbnails.path());
+
+    const QByteArray image(1024, 'a');
+    const QString ref = ThumbnailStore::put(image);
+    QCOMPARE(ref.size(), 40);
+    QCOMPARE(ThumbnailStore::put(QByteArray(image)), ref); // stored once
+    QCOMPARE(QDir(m_thumbnails.filePath(ref.left(2))).entryList({"*.png"}, QDir::Files),
+             QStringList({ref + ".png"}));
+    QCOMPARE(ThumbnailStore::get(ref), image);
+    const QString unused = ThumbnailStore::put(QByteArray(1024, 'b'));
+    QVERIFY(ThumbnailStore::contains(unused));
+
+    QVERIFY(ThumbnailStore::publish("some root", {ref}));
+    QCOMPARE(ThumbnailStore::collect(), 0); // within the grace period
+    QVERIFY(ThumbnailStore::collect(0) >= 1);
+    QVERIFY(ThumbnailStore::contains(ref));
+    QVERIFY(!ThumbnailStore::contains(unused));
+}
+
+void TestYayc::categoryTree()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QDir root(dir.path());
+    QVERIFY(root.mkpath("music/live"));
+    QVERIFY(root.mkpath("news"));
+    QVERIFY(root.mkpath(".channels"));
+
+    CategoryTree tree;
+    tree.reset(QDir::cleanPath(root.absolutePath()));
+    tree.scan();
+    CategoryTree::Node *r = tree.root();
+    QVERIFY(r);
+    QCOMPARE(r->dirs.size(), 2); // hidden directories are not categories
+    CategoryTree::Node *live = tree.node(root.absoluteFilePath("music/live"));
+    QVERIFY(live);
+    QCOMPARE(live->name, QString("live"));
+    QCOMPARE(live->parent, tree.node(root.absoluteFilePath("music")));
+    QVERIFY(!tree.ensure(QDir::tempPath() + "/elsewhere"));
+    QVERIFY(!tree.node(root.absoluteFilePath("unknown")));
+    QCOMPARE(CategoryTable::find(root.absoluteFilePath("unknown")), CategoryTable::Id(0)); // not interned
+
+    QCOMPARE(r->dirs.at(0)->name, QString("music")); // subcategories by name
+    QCOMPARE(r->dirs.at(1)->name, QString("news"));
+
+    tree.appendVideo(live, "YTBv_aaaaaaaaaaa", 0, 300);
+    tree.insertVideo(r, CategoryTree::videoSlot(r, 200), "YTBv_bbbbbbbbbbb", 1, 200);
+    tree.insertVideo(r, CategoryTree::videoSlot(r, 100), "YTBv_ccccccccccc", 2, 100);
+    tree.appendVideo(r, "YTBv_ddddddddddd", 3, 150);
+    QCOMPARE(tree.videoNode("YTBv_aaaaaaaaaaa"), live);
+    QCOMPARE(r->videoRow("YTBv_ccccccccccc"), 2); // after the subcategories, oldest first
+    QCOMPARE(r->rowCount(), 5);
+    QCOMPARE(tree.sortVideos(r), QList<int>({0, 2, 1}));
+    QCOMPARE(r->videos, QStringList({"YTBv_ccccccccccc", "YTBv_ddddddddddd", "YTBv_bbbbbbbbbbb"}));
+    QCOMPARE(r->tableRows, QList<int>({2, 3, 1}));
+
+    CategoryTree::Node *news = tree.node(root.absoluteFilePath("news"));
+    tree.moveCategory(live, news);
+    QCOMPARE(live->parent, news);
+    QCOMPARE(tree.videoNode("YTBv_aaaaaaaaaaa"), live);
+
+    tree.removeCategory(news);
+    QVERIFY(!tree.videoNode("YTBv_aaaaaaaaaaa"));
+    QCOMPARE(tree.videoCount(), qsizetype(3));
+    QCOMPARE(r->dirs.size(), 1);
+
+    QCOMPARE(r->videoRow("YTBv_bbbbbbbbbbb"), 3);
+    tree.removeVideos(r, 0, 2); // a run of rows
+    QVERIFY(!tree.videoNode("YTBv_ccccccccccc"));
+    QVERIFY(!tree.videoNode("YTBv_ddddddddddd"));
+    QCOMPARE(r->videoRow("YTBv_ddddddddddd"), -1);
+    QCOMPARE(r->videoRow("YTBv_bbbbbbbbbbb"), 1);
+    QCOMPARE(r->tableRows, QList<int>({1}));
+    QCOMPARE(tree.videoCount(), qsizetype(1));
+}
+
+void TestYayc::workingDirIndex()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QDir root(dir.path());
+    QVERIFY(root.mkpath("YTBv_aaaaaaaaaaa"));
+    QVERIFY(root.mkpath("YTBv_bbbbbbbbbbb/notes"));
+    QFile summary(root.absoluteFilePath("YTBv_bbbbbbbbbbb/notes/video.summary.txt"));
+    QVERIFY(summary.open(QIODevice::WriteOnly));
+    summary.close();
+
+    WorkingDirIndex index;
+    QSignalSpy changed(&index, &WorkingDirIndex::changed);
+    index.setRoot(root.absolutePath());
+    QCOMPARE(index.state("YTBv_aaaaaaaaaaa"), quint8(WorkingDirIndex::Exists));
+    QCOMPARE(index.state("YTBv_bbbbbbbbbbb"),
+             quint8(WorkingDirIndex::Exists | WorkingDirIndex::NonEmpty | WorkingDirIndex::HasSummary));
+    QCOMPARE(index.state("YTBv_ccccccccccc"), quint8(0));
+
+    QFile video(root.absoluteFilePath("YTBv_aaaaaaaaaaa/video.mp4"));
+    QVERIFY(video.open(QIODevice::WriteOnly));
+    video.close();
+    index.refresh(root.absolutePath() + "/", "YTBv_aaaaaaaaaaa");
+    QCOMPARE(index.state("YTBv_aaaaaaaaaaa"), quint8(WorkingDirIndex::Exists | WorkingDirIndex::NonEmpty));
+
+    QVERIFY(QDir(root.absoluteFilePath("YTBv_bbbbbbbbbbb")).removeRecursively());
+    index.refresh(root.absolutePath(), "YTBv_bbbbbbbbbbb");
+    QCOMPARE(index.state("YTBv_bbbbbbbbbbb"), quint8(0));
+
+    // Changes inside a known folder, down in a subfolder, are picked up without refresh()
+    changed.clear();
+    QVERIFY(root.mkpath("YTBv_aaaaaaaaaaa/notes"));
+    QFile late(root.absoluteFilePath("YTBv_aaaaaaaaaaa/notes/video.summary.txt"));
+    QVERIFY(late.open(QIODevice::WriteOnly));
+    late.close();
+    QTRY_COMPARE(index.state("YTBv_aaaaaaaaaaa"),
+                 quint8(WorkingDirIndex::Exists | WorkingDirIndex::NonEmpty | WorkingDirIndex::HasSummary));
+    QTRY_VERIFY(!changed.isEmpty());
+    QVERIFY(changed.constLast().at(0).toStringList().contains("YTBv_aaaaaaaaaaa"));
+
+    QVERIFY(root.mkpath("YTBv_ccccccccccc"));
+    QTRY_COMPARE(index.state("YTBv_ccccccccccc"), quint8(WorkingDirIndex::Exists));
+}
+
+// External changes come in through the RootWatcher. A record whose file went is dropped,
+// unless the app has yet to write it.
+void TestYayc::directoryChanges()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QDir root(dir.path());
+    QVERIFY(root.mkpath("music"));
+    VideoMetadata gone("YTBv_aaaaaaaaaaa", QDir(root.filePath("music")));
+    VideoMetadata unsaved("YTBv_bbbbbbbbbbb", QDir(root.filePath("music")));
+    for (auto *v : {&gone, &unsaved}) {
+        v->title = v->key;
+        v->dirty = true;
+        v->saveFile();
+    }
+
+    QQmlApplicationEngine engine;
+    engine.addImageProvider(QLatin1String("videothumbnail"), new ThumbnailImageProvider);
+    FileSystemModel *model = new FileSystemModel("directoryChangesModel", false, &engine);
+    model->setRoot(root.absolutePath());
+    QVERIFY(model->isVideoBookmarked(gone.key));
+    QVERIFY(model->updateEntry(unsaved.key, "renamed", "https://www.youtube.com/@someone", {}, {}, 100., 10.));
+    QVERIFY(model->unsavedChanges() > 0); // not synced
+
+    QVERIFY(QFile::remove(gone.filePath()));
+    QVERIFY(QFile::remove(unsaved.filePath()));
+    QTRY_VERIFY(!model->isVideoBookmarked(gone.key));
+    QVERIFY(model->isVideoBookmarked(unsaved.key));
+
+    model->sync();
+    QTRY_VERIFY(QFile::exists(unsaved.filePath()));
+    QVERIFY(model->isVideoBookmarked(unsaved.key));
+}
+
+// The filter runs on a worker and is applied later. A newer term cancels the pass in
+// flight, and rows that change in between are not judged by the stale outcome.
+void TestYayc::asyncFilter()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QDir root(dir.path());
+    QVERIFY(root.mkpath("music"));
+    const QStringList keys{"YTBv_aaaaaaaaaaa", "YTBv_bbbbbbbbbbb", "YTBv_ccccccccccc"};
+    const QStringList titles{"alpha one", "alpha two", "beta three"};
+    for (int i = 0; i < keys.size(); ++i) {
+        VideoMetadata v(keys.at(i), QDir(root.filePath("music")));
+        v.title = titles.at(i);
+        v.dirty = true;
+        v.saveFile();
+    }
+
+    QQmlApplicationEngine engine;
+    engine.addImageProvider(QLatin1String("videothumbnail"), new ThumbnailImageProvider);
+    FileSystemModel *model = new FileSystemModel("asyncFilterModel", false, &engine);
+    const QModelIndex rootIndex = model->setRoot(root.absolutePath());
+    auto *proxy = qvariant_cast<NoDirSortProxyModel *>(model->sortFilterProxyModel());
+    QVERIFY(proxy);
+    const QModelIndex category = proxy->index(0, 0, rootIndex);
+    QVERIFY(category.isValid());
+    QCOMPARE(proxy->rowCount(category), 3);
+    const auto title = [&](int row) {
+        return proxy->index(row, 0, category).data(FileSystemModel::TitleRole).toString();
+    };
+
+    proxy->setSearchTerm("alpha");
+    QTRY_COMPARE(proxy->rowCount(category), 2);
+
+    proxy->setSearchTerm("beta");
+    proxy->setSearchTerm("alpha two"); // before the "beta" pass could be applied
+    QTRY_COMPARE(proxy->rowCount(category), 1);
+    QTest::qWait(100);
+    QCOMPARE(proxy->rowCount(category), 1);
+    QCOMPARE(title(0), QString("alpha two"));
+
+    // Starred after the snapshot was taken: its bit in the pass is stale
+    proxy->setProperty("searchInStarred", false);
+    proxy->setSearchTerm("alpha");
+    model->starEntry(keys.at(0), true);
+    QTRY_COMPARE(proxy->rowCount(category), 1);
+    QTest::qWait(100);
+    QCOMPARE(proxy->rowCount(category), 1);
+    QCOMPARE(title(0), QString("alpha two"));
+
+    // Retitled after the pass: matched on its own title
+    proxy->setSearchTerm("gamma");
+    QTRY_COMPARE(proxy->rowCount(category), 0);
+    model->updateTitle(keys.at(2), "gamma three");
+    QTRY_COMPARE(proxy->rowCount(category), 1);
+    QCOMPARE(title(0), QString("gamma three"));
+
+    proxy->setSearchTerm(QString());
+    QTRY_COMPARE(proxy->rowCount(category), 2);
+}
+
+// Changes of a frame go out as one dataChanged per run of adjacent rows with the same
+// roles, and the filter is told through FilterStateRole rather than a role that did not change
+void TestYayc::rowNotifications()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QDir root(dir.path());
+    QVERIFY(root.mkpath("music"));
+    const QStringList keys{"YTBv_aaaaaaaaaaa", "YTBv_bbbbbbbbbbb", "YTBv_ccccccccccc"};
+    for (const QString &key : keys) {
+        VideoMetadata v(key, QDir(root.filePath("music")));
+        v.title = key;
+        v.dirty = true;
+        v.saveFile();
+    }
+
+    QQmlApplicationEngine engine;
+    engine.addImageProvider(QLatin1String("videothumbnail"), new ThumbnailImageProvider);
+    FileSystemModel *model = new FileSystemModel("rowNotificationsModel", false, &engine);
+    model->setRoot(root.absolutePath());
+    auto *proxy = qvariant_cast<NoDirSortProxyModel *>(model->sortFilterProxyModel());
+    QVERIFY(proxy);
+    QCOMPARE(proxy->filterRole(), int(FileSystemModel::FilterStateRole));
+
+    QSignalSpy spy(model, &QAbstractItemModel::dataChanged);
+    const auto filterChanges = [&]() { // others may come from thumbnails and the like
+        QList<QList<QVariant>> result;
+        for (const auto &args : std::as_const(spy)) {
+            if (args.at(2).value<QList<int>>().contains(FileSystemModel::FilterStateRole))
+                result.append(args);
+        }
+        return result;
+    };
+
+    for (const QString &key : keys)
+        model->starEntry(key, true);
+    QTRY_COMPARE(filterChanges().size(), 1);
+    QList<QVariant> args = filterChanges().first();
+    QModelIndex first = args.at(0).toModelIndex();
+    QModelIndex last = args.at(1).toModelIndex();
+    QCOMPARE(first.parent(), last.parent());
+    QCOMPARE(last.row() - first.row(), 2);
+    QCOMPARE(args.at(2).value<QList<int>>(),
+             (QList<int>{FileSystemModel::VersionRole, FileSystemModel::FilterStateRole}));
+    for (int row = first.row(); row <= last.row(); ++row) {
+        const QModelIndex index = first.siblingAtRow(row);
+        QVERIFY(index.data(FileSystemModel::FilterStateRole).toInt() & MetadataTable::Starred);
+    }
+
+    spy.clear();
+    model->updateTitle(keys.at(1), "renamed");
+    QTRY_COMPARE(filterChanges().size(), 1);
+    args = filterChanges().first();
+    first = args.at(0).toModelIndex();
+    QCOMPARE(args.at(1).toModelIndex(), first);
+    QCOMPARE(first.data(FileSystemModel::KeyRole).toString(), keys.at(1));
+    const QList<int> roles = args.at(2).value<QList<int>>();
+    QCOMPARE(roles, (QList<int>{FileSystemModel::TitleRole, FileSystemModel::FilterStateRole}));
+    QVERIFY(!roles.contains(Qt::DisplayRole));
+}
+
+// Every video of a channel that gets its name shows it, through the coalesced notifications
+void TestYayc::channelRename()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QDir root(dir.path());
+    QVERIFY(root.mkpath("music"));
+    const QStringList keys{"YTBv_aaaaaaaaaaa", "YTBv_bbbbbbbbbbb", "YTBv_ccccccccccc"};
+    for (const QString &key : keys) {
+        VideoMetadata v(key, QDir(root.filePath("music")));
+        v.title = key;
+        if (key != keys.at(2))
+            v.channelID = "@synths";
+        v.dirty = true;
+        v.saveFile();
+    }
+
+    QQmlApplicationEngine engine;
+    engine.addImageProvider(QLatin1String("videothumbnail"), new ThumbnailImageProvider);
+    FileSystemModel *model = new FileSystemModel("channelRenameModel", true, &engine);
+    model->setRoot(root.absolutePath());
+
+    QSignalSpy spy(model, &QAbstractItemModel::dataChanged);
+    const auto renamed = [&]() {
+        QStringList result;
+        for (const auto &args : std::as_const(spy)) {
+            if (!args.at(2).value<QList<int>>().contains(FileSystemModel::ChannelNameRole))
+                continue;
+            const QModelIndex first = args.at(0).toModelIndex();
+            for (int row = first.row(); row <= args.at(1).toModelIndex().row(); ++row) {
+                const QModelIndex index = first.siblingAtRow(row);
+                result.append(index.data(FileSystemModel::KeyRole).toString() + ' '
+                              + index.data(FileSystemModel::ChannelNameRole).toString());
+            }
+        }
+        result.sort();
+        return result;
+    };
+
+    model->updateEntry(keys.at(0), keys.at(0), "https://www.youtube.com/@synths", QString(), "Synths", 0, 0);
+    QTRY_COMPARE(renamed(), (QStringList{keys.at(0) + " Synths", keys.at(1) + " Synths"}));
+
+    spy.clear();
+    model->updateEntry(keys.at(1), keys.at(1), "https://www.youtube.com/@synths", QString(), "Synths", 0, 0);
+    QTest::qWait(50); // a flush went by
+    QVERIFY(renamed().isEmpty());
+    model->updateEntry(keys.at(1), keys.at(1), "https://www.youtube.com/@synths", QString(), "Synth Wave", 0, 0);
+    QTRY_COMPARE(renamed(), (QStringList{keys.at(0) + " Synth Wave", keys.at(1) + " Synth Wave"}));
+}
+
+void TestYayc::trigramIndex()
+{
+    TrigramIndex index;
+    index.insert(0, "Building a Synth\nYTBv_aaaaaaaaaaa");
+    index.insert(1, "Synthwave mix\nYTBv_bbbbbbbbbbb");
+    index.insert(3, "The Night Sky\nYTBv_ccccccccccc");
+    QCOMPARE(index.size(), qsizetype(3));
+
+    QCOMPARE(index.find("SYNTH"), QList<int>({0, 1}));
+    QCOMPARE(index.find("nth"), QList<int>({0, 1}));
+    QCOMPARE(index.find("ht s"), QList<int>({3}));
+    QCOMPARE(index.find("sy"), QList<int>({0, 1})); // no trigram, every text is compared
+    index.insert(4, "abcd bcde");
+    QCOMPARE(index.find("abcde"), QList<int>()); // every trigram is there, not in a row
+    index.remove(4);
+    QCOMPARE(index.find("bbbbb"), QList<int>({1}));
+    QCOMPARE(index.narrow("synthw", {0, 1}), QList<int>({1})); // the term was extended
+
+    QVERIFY(!index.insert(1, "Synthwave mix\nYTBv_bbbbbbbbbbb"));
+    QVERIFY(index.insert(1, "Ambient mix\nYTBv_bbbbbbbbbbb"));
+    QCOMPARE(index.find("synth"), QList<int>({0}));
+    QCOMPARE(index.find("ambient"), QList<int>({1}));
+
+    index.remove(0);
+    QCOMPARE(index.find("synth"), QList<int>());
+    QCOMPARE(index.size(), qsizetype(2));
+    index.insert(0, "Synth again");
+    QCOMPARE(index.find("synth"), QList<int>({0}));
+}
+
+void TestYayc::fuzzyIndex()
+{
+    QCOMPARE(FuzzyIndex::words("  Kubernetes: the GOOD parts!"), QString("kubernetes the good parts"));
+    QCOMPARE(FuzzyIndex::prefixDistance(u"kubernets", u"kubernetes", 2), 1);
+    QCOMPARE(FuzzyIndex::prefixDistance(u"kubrenetes", u"kubernetes", 2), 2);
+    QCOMPARE(FuzzyIndex::prefixDistance(u"synth", u"synthwave", 1), 0);
+    QCOMPARE(FuzzyIndex::prefixDistance(u"docker", u"kubernetes", 2), 3);
+
+    FuzzyIndex index;
+    index.insert(0, "Kubernetes in 10 minutes", "TechWorld");
+    index.insert(1, "Cooking pasta", "Kubernetes Explained");
+    index.insert(2, "Docker basics", "TechWorld");
+
+    const auto hits = index.find("kubernets", true, true);
+    QCOMPARE(hits.size(), 2);
+    QCOMPARE(hits.at(0).doc, 0);
+    QCOMPARE(hits.at(1).doc, 1);
+    QVERIFY(hits.at(0).score > hits.at(1).score); // title above channel
+    QCOMPARE(index.find("kubernets", true, false).size(), 1);
+    QCOMPARE(index.find("tech dock", true, true).size(), 1); // every word, prefixes
+    QCOMPARE(index.find("tech pasta", true, true).size(), 0);
+
+    QVERIFY(!index.insert(2, "Docker basics", "TechWorld"));
+    index.remove(0);
+    QCOMPARE(index.find("kubernetes", true, false).size(), 0);
+}
+
+void TestYayc::cacheRootBenchmark_data()
+{
+    QTest::addColumn<int>("threads");
+    QTest::newRow("serial")   << 1;
+    QTest::newRow("parallel") << 0;
+    createBenchLibrary();
+}
+
+void TestYayc::cacheRootBenchmark()
+{
+    if (!m_benchEntries)
+        QSKIP("Set YAYC_BENCHMARK to run");
+    QFETCH(int, threads);
+
+    const QDir root(m_benchRoot.path());
+    QHash<QString, VideoMetadata> res;
+    QBENCHMARK {
+        res = cacheRoot(root, threads);
+    }
+    QCOMPARE(res.size(), m_benchEntries);
+}
+
+void TestYayc::libraryStreamBenchmark_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::newRow("ndjson") << int(LibraryStream::Ndjson);
+    QTest::newRow("cbor")   << int(LibraryStream::Cbor);
+    createBenchLibrary();
+}
+
+// Export then import of the whole synthetic library through memory, records only
+void TestYayc::libraryStreamBenchmark()
+{
+    if (!m_benchEntries)
+        QSKIP("Set YAYC_BENCHMARK to run");
+    QFETCH(int, format);
+
+    const QDir root(m_benchRoot.path());
+    const QHash<QString, VideoMetadata> videos = cacheRoot(root);
+    qint64 bytes = 0;
+    qint64 read = 0;
+    QBENCHMARK {
+        QByteArray stream;
+        QBuffer out(&stream);
+        out.open(QIODevice::WriteOnly);
+        LibraryWriter w(&out, LibraryStream::Format(format), root, false);
+        w.header(videos.size(), 0);
+        for (const auto &v : videos)
+            w.video(v);
+        out.close();
+        bytes = stream.size();
+
+        QBuffer in(&stream);
+        in.open(QIODevice::ReadOnly);
+        LibraryReader r(&in, root);
+        read = 0;
+        for (auto item = r.next(); item.type != LibraryReader::Item::End; item = r.next()) {
+            QVERIFY(item.type != LibraryReader::Item::Error);
+            read += (item.type == LibraryReader::Item::Video);
+        }
+    }
+    QCOMPARE(read, qint64(m_benchEntries));
+    QVERIFY2(bytes / m_benchEntries < 512, qPrintable(QString("%1 bytes per entry").arg(bytes / m_benchEntries)));
+}
+
+void TestYayc::scrollBenchmark_data()
+{
+    QTest::addColumn<QList<int>>("roles");
+    QTest::newRow("delegate") << QList<int>{Qt::DisplayRole, FileSystemModel::IsDirRole, FileSystemModel::KeyRole,
+                                            FileSystemModel::VersionRole, FileSystemModel::TitleRole};
+    QTest::newRow("sort and filter") << QList<int>{FileSystemModel::FileNameRole, FileSystemModel::CreatedRole,
+                                                   FileSystemModel::TitleRole, FileSystemModel::ChannelNameRole};
+    createBenchLibrary();
+}
+
+// Role reads of a view scrolling through a whole category, through the proxy as the TreeView does
+void TestYayc::scrollBenchmark()
+{
+    if (!m_benchEntries)
+        QSKIP("Set YAYC_BENCHMARK to run");
+    QFETCH(QList<int>, roles);
+
+    QQmlApplicationEngine engine;
+    engine.addImageProvider(QLatin1String("videothumbnail"), new ThumbnailImageProvider);
+    FileSystemModel *model = new FileSystemModel("benchModel", true, &engine);
+    const QModelIndex root = model->setRoot(m_benchRoot.path());
+    auto *proxy = qvariant_cast<NoDirSortProxyModel *>(model->sortFilterProxyModel());
+    QVERIFY(proxy);
+    const QModelIndex category = proxy->index(0, 0, root);
+    QVERIFY(model->isDir(proxy->mapToSource(category)));
+    const int rows = proxy->rowCount(category);
+    QVERIFY(rows > 0);
+
+    qsizetype chars = 0;
+    QBENCHMARK {
+        for (int i = 0; i < rows; ++i) {
+            const QModelIndex idx = proxy->index(i, 0, category);
+            for (int role : roles)
+                chars += proxy->data(idx, role).toString().size();
+        }
+    }
+    QVERIFY(chars > 0);
+}
+
 QTEST_MAIN(TestYayc)
 #include "tst_yayc.moc"
@@ -28,9 +28,27 @@ SOURCES += \
         src/Platform.cpp \
         src/VideoMetadata.cpp \
         src/ChannelMetadata.cpp \
+        src/MetadataJournal.cpp \
+        src/CacheSnapshot.cpp \
+        src/MetadataWriter.cpp \
+        src/MetadataTable.cpp \
+        src/VideoKey.cpp \
+        src/CategoryTable.cpp \
+        src/RecordFormat.cpp \
+        src/PositionLog.cpp \
+        src/RootWatcher.cpp \
+        src/LibraryStream.cpp \
+        src/HistoryArchive.cpp \
+        src/CategoryTree.cpp \
+        src/WorkingDirIndex.cpp \
+        src/TrigramIndex.cpp \
+        src/FuzzyIndex.cpp \
+        src/SearchResultModel.cpp \
+        src/SearchIndexes.cpp \
         src/NoDirSortProxyModel.cpp \
         src/FileSystemModel.cpp \
         src/ThumbnailFetcher.cpp \
+        src/ThumbnailStore.cpp \
         src/RequestInterceptor.cpp \
         src/YaycUtilities.cpp \
         src/qqmlsettings.cpp \
@@ -40,11 +58,30 @@ HEADERS += \
         src/Platform.h \
         src/VideoMetadata.h \
         src/ChannelMetadata.h \
+        src/MetadataJournal.h \
+        src/CacheSnapshot.h \
+        src/MetadataWriter.h \
+        src/MetadataTable.h \
+        src/VideoKey.h \
+        src/CategoryTable.h \
+        src/RecordFormat.h \
+        src/PositionLog.h \
+        src/RootWatcher.h \
+        src/LibraryStream.h \
+        src/HistoryArchive.h \
+        src/CategoryTree.h \
+        src/WorkingDirIndex.h \
+        src/TrigramIndex.h \
+        src/FuzzyIndex.h \
+        src/SearchResultModel.h \
+        src/SearchIndexes.h \
+        src/DirtyKeys.h \
         src/ThumbnailImageProvider.h \
         src/EmptyIconProvider.h \
         src/NoDirSortProxyModel.h \
         src/FileSystemModel.h \
         src/ThumbnailFetcher.h \
+        src/ThumbnailStore.h \
         src/RequestInterceptor.h \
         src/YaycUtilities.h \
         src/KeyInterceptor.h \